@@ -147,7 +147,7 @@ void AggroBAIState::think(BattleAction *action)
 	{
 		// if we see the target, we either can shoot him, or take cover.
 		bool takeCover = true;
-		int number = RNG::generate(0,100);
+		int number = RNG::generate(RNG::STREAM_AI, 0,100);
 
 		// lost health, chances to take cover get bigger
 		if (_unit->getHealth() < _unit->getUnit()->getHealth())
@@ -205,7 +205,7 @@ void AggroBAIState::think(BattleAction *action)
 				}
 				else
 				{
-					if (RNG::generate(1,10) < 5)
+					if (RNG::generate(RNG::STREAM_AI, 1,10) < 5)
 						action->type = BA_SNAPSHOT;
 					else
 						action->type = BA_AUTOSHOT;
@@ -223,31 +223,37 @@ void AggroBAIState::think(BattleAction *action)
 		{
 			// the idea is to check within a 5 tile radius for a tile which is not seen by our aggroTarget
 			// if there is no such tile, we run away from the target.
+			// only tiles we can reach this turn are considered, so no path has to be searched for each try.
+			std::vector<Position> reachable;
+			for (int x = -5; x <= 5; ++x)
+			{
+				for (int y = -5; y <= 5; ++y)
+				{
+					Position pos = _unit->getPosition() + Position(x, y, 0);
+					if ((x != 0 || y != 0) && _game->getPathfinding()->getReachableCost(_unit, pos) != -1)
+					{
+						reachable.push_back(pos);
+					}
+				}
+			}
+			if (reachable.empty())
+			{
+				// nowhere to go, and the shot we can't afford mustn't go off either
+				action->type = BA_NONE;
+				action->TU = 0;
+				return;
+			}
 			action->type = BA_WALK;
 			int tries = 0;
 			bool coverFound = false;
 			while (tries < 30 && !coverFound)
 			{
 				tries++;
-				action->target = _unit->getPosition();
-				action->target.x += RNG::generate(-5,5);
-				action->target.y += RNG::generate(-5,5);
+				action->target = reachable[RNG::generate(RNG::STREAM_AI, 0, (int)reachable.size() - 1)];
 				if (tries < 20)
-
 					coverFound = !_game->getTileEngine()->visible(_aggroTarget, _game->getTile(action->target));
 				else
 					coverFound = true;
-
-				if (coverFound)
-				{
-					// check if we can reach this tile
-					_game->getPathfinding()->calculate(_unit, action->target);
-					if (_game->getPathfinding()->getStartDirection() == -1)
-					{
-						coverFound = false;
-					}
-					_game->getPathfinding()->abortPath();
-				}
 			}
 		}
 	}
@@ -0,0 +1,691 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BattleSimulator.h"
+#include <sstream>
+#include <iomanip>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "TileEngine.h"
+#include "Pathfinding.h"
+#include "Projectile.h"
+#include "ProjectileFlyBState.h"
+#include "AggroBAIState.h"
+#include "PatrolBAIState.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/BattleItem.h"
+#include "../Savegame/Tile.h"
+#include "../Savegame/Unit.h"
+#include "../Ruleset/Ruleset.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Ruleset/RuleArmor.h"
+#include "../Ruleset/RuleGenUnit.h"
+#include "../Ruleset/MapData.h"
+#include "../Engine/Options.h"
+#include "../Engine/RNG.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up a simulator for a battle that is already loaded.
+ * @param save Pointer to the battle, with its map resources loaded.
+ * @param res Pointer to the resource pack.
+ * @param rules Pointer to the ruleset.
+ */
+BattleSimulator::BattleSimulator(SavedBattleGame *save, ResourcePack *res, Ruleset *rules) : _save(save), _res(res), _rules(rules), _actions(0), _steps(0), _shots(0), _casualties(0)
+{
+	_startTurn = _save->getTurn();
+	// the simulator reports the profiler zones, so it always needs them
+	Profiler::setEnabled(true);
+	for (int i = 0; i < Profiler::ZONE_TOTAL; ++i)
+	{
+		_startTime[i] = Profiler::getTotal((Profiler::Zone)i);
+	}
+}
+
+/**
+ * Deletes the simulator.
+ */
+BattleSimulator::~BattleSimulator()
+{
+
+}
+
+/**
+ * Lets every unit of the current side act, then ends the turn.
+ */
+void BattleSimulator::playTurn()
+{
+	UnitFaction side = _save->getSide();
+	for (size_t i = 0; i < _save->getUnits()->size() && !isOver(); ++i)
+	{
+		BattleUnit *unit = _save->getUnits()->at(i);
+		if (unit->getFaction() == side && !unit->isOut())
+		{
+			playUnit(unit);
+		}
+	}
+	if (!isOver())
+	{
+		endTurn();
+	}
+}
+
+/**
+ * Checks if either X-Com or the aliens have no units left standing.
+ * @return True if the battle is over.
+ */
+bool BattleSimulator::isOver() const
+{
+	bool player = false, hostile = false;
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if (!(*i)->isOut())
+		{
+			player = player || (*i)->getFaction() == FACTION_PLAYER;
+			hostile = hostile || (*i)->getFaction() == FACTION_HOSTILE;
+		}
+	}
+	return !player || !hostile;
+}
+
+/**
+ * Returns the number of full turns played since the simulator was created.
+ * @return Number of turns.
+ */
+int BattleSimulator::getTurns() const
+{
+	return _save->getTurn() - _startTurn;
+}
+
+/**
+ * Runs the AI of a unit, the same way BattlescapeGame does it:
+ * two actions per unit, or until it has nothing left to do.
+ * Units without an AI routine (the X-Com soldiers) start patrolling.
+ * @param unit Pointer to the unit.
+ */
+void BattleSimulator::playUnit(BattleUnit *unit)
+{
+	if (!unit->getCurrentAIState())
+	{
+		unit->setAIState(new PatrolBAIState(_save, unit, 0));
+	}
+
+	for (int i = 0; i < MAX_UNIT_ACTIONS && !unit->isOut(); ++i)
+	{
+		BattleAction action;
+		{
+			Profiler::Scope scope(Profiler::ZONE_AI);
+			unit->think(&action);
+		}
+		_actions++;
+
+		if (action.type == BA_WALK)
+		{
+			walk(action);
+		}
+		else if (action.type == BA_SNAPSHOT || action.type == BA_AUTOSHOT || action.type == BA_THROW)
+		{
+			shoot(action);
+		}
+		else
+		{
+			if (dynamic_cast<AggroBAIState*>(unit->getCurrentAIState()) != 0)
+			{
+				// we lost aggro
+				unit->setAIState(new PatrolBAIState(_save, unit, 0));
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * Walks a unit to the action target step by step, like UnitWalkBState
+ * but without the walking animation. Walking stops when the unit runs
+ * out of time units, spots a new unit or is fired upon.
+ * @param action Walking action.
+ */
+void BattleSimulator::walk(BattleAction &action)
+{
+	BattleUnit *unit = action.actor;
+	Pathfinding *pf = _save->getPathfinding();
+	TileEngine *te = _save->getTileEngine();
+	int size = unit->getUnit()->getArmor()->getSize() - 1;
+
+	pf->calculate(unit, action.target);
+
+	int dir;
+	while ((dir = pf->getStartDirection()) != -1 && !unit->isOut())
+	{
+		Position destination;
+		int tu = pf->getTUCost(unit->getPosition(), dir, &destination, unit);
+		if (tu > unit->getTimeUnits())
+		{
+			break;
+		}
+
+		// turning during walking costs no tu
+		if (dir != unit->getDirection() && dir < Pathfinding::DIR_UP)
+		{
+			unit->lookAt(dir);
+			while (unit->getStatus() == STATUS_TURNING)
+			{
+				unit->turn();
+			}
+			if (calculateFOV(unit))
+			{
+				break;
+			}
+		}
+
+		// ufo doors open instantly, there's no animation to wait for
+		int door = te->unitOpensDoor(unit);
+		for (int frame = 0; (door == 1 || door == 3) && frame < MAX_DOOR_FRAMES; ++frame)
+		{
+			for (int x = -1; x <= size + 1; ++x)
+			{
+				for (int y = -1; y <= size + 1; ++y)
+				{
+					Tile *t = _save->getTile(unit->getPosition() + Position(x, y, 0));
+					if (t) t->animate();
+				}
+			}
+			door = te->unitOpensDoor(unit);
+		}
+
+		dir = pf->dequeuePath();
+		// don't spend anything unless the unit can afford both
+		if (unit->getTimeUnits() < tu || unit->getEnergy() < tu)
+		{
+			break;
+		}
+		unit->spendTimeUnits(tu, false);
+		unit->spendEnergy(tu, false);
+		Position from = unit->getPosition();
+		unit->startWalking(dir, destination);
+		while (unit->getStatus() == STATUS_WALKING || unit->getStatus() == STATUS_FLYING)
+		{
+			unit->keepWalking();
+		}
+		_steps++;
+
+		for (int x = size; x >= 0; x--)
+		{
+			for (int y = size; y >= 0; y--)
+			{
+				_save->getTile(from + Position(x,y,0))->setUnit(0);
+			}
+		}
+		for (int x = size; x >= 0; x--)
+		{
+			for (int y = size; y >= 0; y--)
+			{
+				_save->getTile(unit->getPosition() + Position(x,y,0))->setUnit(unit);
+			}
+		}
+		_save->updateUnitGrid(unit);
+		pf->invalidateReachable();
+
+		te->calculateUnitLighting();
+
+		// check for proximity grenades
+		for (int x = -1; x <= size + 1; ++x)
+		{
+			for (int y = -1; y <= size + 1; ++y)
+			{
+				Tile *t = _save->getTile(unit->getPosition() + Position(x, y, 0));
+				if (t == 0)
+					continue;
+				for (std::vector<BattleItem*>::iterator i = t->getInventory()->begin(); i != t->getInventory()->end(); ++i)
+				{
+					if ((*i)->getRules()->getBattleType() == BT_PROXIMITYGRENADE && (*i)->getExplodeTurn() > 0)
+					{
+						BattleItem *grenade = *i;
+						_save->removeItem(grenade);
+						Position p = Position(t->getPosition().x*16 + 8, t->getPosition().y*16 + 8, t->getPosition().z*24 + t->getTerrainLevel());
+						explode(p, grenade, grenade->getPreviousOwner(), 0);
+						pf->abortPath();
+						return;
+					}
+				}
+			}
+		}
+
+		// check for reaction fire
+		BattleAction reaction;
+		bool reacted = te->checkReactionFire(unit, &reaction);
+		if (reacted)
+		{
+			shoot(reaction);
+			break;
+		}
+
+		if (calculateFOV(unit))
+		{
+			break;
+		}
+	}
+
+	pf->abortPath();
+	if (!unit->isOut())
+	{
+		te->calculateUnitLighting();
+		calculateFOV(unit);
+	}
+}
+
+/**
+ * Fires a weapon or throws an item, like ProjectileFlyBState
+ * but without the projectile animation.
+ * @param action Shooting or throwing action.
+ */
+void BattleSimulator::shoot(BattleAction &action)
+{
+	BattleUnit *unit = action.actor;
+	BattleItem *weapon = action.weapon;
+	if (!weapon || unit->isOut() || !_save->getTile(action.target) || unit->getTimeUnits() < action.TU)
+		return;
+
+	BattleItem *ammo = weapon->getAmmoItem();
+	if (action.type == BA_THROW)
+	{
+		if (!ProjectileFlyBState::validThrowRange(&action))
+			return;
+	}
+	else if (ammo == 0 || ammo->getAmmoQuantity() == 0)
+	{
+		return;
+	}
+
+	// autoshot will default back to snapshot if it's not possible
+	if (weapon->getRules()->getAccuracyAuto() == 0 && action.type == BA_AUTOSHOT)
+		action.type = BA_SNAPSHOT;
+
+	BattleUnit *victim = _save->getTile(action.target)->getUnit();
+	int shots = (action.type == BA_AUTOSHOT) ? 3 : 1;
+
+	for (int i = 0; i < shots && !unit->isOut(); ++i)
+	{
+		Projectile projectile(_res, _save, action);
+		if (action.type == BA_THROW)
+		{
+			if (!projectile.calculateThrow(unit->getThrowingAccuracy()))
+				break;
+			weapon->moveToOwner(0);
+			unit->addThrowingExp();
+			while (projectile.move());
+
+			Position pos = projectile.getPosition(-1);
+			if (Options::getBool("battleAltGrenade") && weapon->getRules()->getBattleType() == BT_GRENADE)
+			{
+				// it's a hot grenade to explode immediatly
+				explode(pos, weapon, unit, 0);
+			}
+			else
+			{
+				dropItem(Position(pos.x / 16, pos.y / 16, pos.z / 24), weapon);
+			}
+		}
+		else
+		{
+			int impact = projectile.calculateTrajectory(unit->getFiringAccuracy(action.type, weapon));
+			if (impact == -1)
+				break;
+			if (!ammo->spendBullet())
+			{
+				_save->removeItem(ammo);
+				weapon->setAmmoItem(0);
+			}
+			while (projectile.move());
+
+			if (impact != 5) // out of map
+			{
+				// explosions impact not inside the voxel but one step back
+				int offset = 0;
+				if (ammo->getRules()->getDamageType() == DT_HE || ammo->getRules()->getDamageType() == DT_IN)
+				{
+					offset = -1;
+				}
+				explode(projectile.getPosition(offset), ammo, unit, 0);
+			}
+			if (weapon->getAmmoItem() == 0)
+				break;
+		}
+		_shots++;
+	}
+
+	if (!unit->isOut())
+	{
+		unit->aim(false);
+		unit->spendTimeUnits(action.TU, false);
+	}
+
+	// the target may fire back
+	if (victim && !victim->isOut() && victim->getFaction() != unit->getFaction() && !unit->isOut())
+	{
+		BattleAction reaction;
+		bool reacted = _save->getTileEngine()->checkReactionFire(unit, &reaction, victim, false);
+		if (reacted)
+		{
+			shoot(reaction);
+		}
+	}
+}
+
+/**
+ * Makes an explosion take effect right away, like ExplosionBState
+ * once its animation is done, along with any chain reactions.
+ * @param center Center position in voxelspace.
+ * @param item Item involved in the explosion (eg grenade).
+ * @param unit Unit involved in the explosion (eg unit throwing the grenade).
+ * @param tile Tile the explosion is on.
+ */
+void BattleSimulator::explode(const Position &center, BattleItem *item, BattleUnit *unit, Tile *tile)
+{
+	TileEngine *te = _save->getTileEngine();
+	if (item)
+	{
+		te->explode(center, item->getRules()->getPower(), item->getRules()->getDamageType(), item->getRules()->getExplosionRadius(), unit);
+	}
+	if (tile)
+	{
+		te->explode(center, tile->getExplosive(), DT_HE, 100, unit);
+	}
+	if (!tile && !item)
+	{
+		// explosion of a cyberdisc
+		te->explode(center, 120, DT_HE, 8, unit);
+	}
+
+	checkForCasualties(unit);
+
+	// check for terrain explosions
+	Tile *t = te->checkForTerrainExplosions();
+	if (t)
+	{
+		Position p = Position(t->getPosition().x * 16, t->getPosition().y * 16, t->getPosition().z * 24);
+		explode(p, 0, unit, t);
+	}
+}
+
+/**
+ * Knocks down every unit that died or fell unconscious.
+ * Units that explode on death take their surroundings with them.
+ * @param murderer Unit that caused the casualties, if any.
+ */
+void BattleSimulator::checkForCasualties(BattleUnit *murderer)
+{
+	for (size_t i = 0; i < _save->getUnits()->size(); ++i)
+	{
+		BattleUnit *victim = _save->getUnits()->at(i);
+		if (victim->isOut() || victim->getStatus() == STATUS_FALLING)
+			continue;
+		if (victim->getHealth() == 0 || victim->getStunlevel() >= victim->getHealth())
+		{
+			victim->startFalling();
+			while (victim->getStatus() == STATUS_FALLING)
+			{
+				victim->keepFalling();
+			}
+			convertUnitToCorpse(victim);
+			_casualties++;
+
+			// the nearest other alien may take revenge
+			if (victim->getFaction() == FACTION_HOSTILE && murderer)
+			{
+				int closest = 1000000;
+				BattleUnit *revenger = 0;
+				for (std::vector<BattleUnit*>::iterator j = _save->getUnits()->begin(); j != _save->getUnits()->end(); ++j)
+				{
+					if ((*j)->getFaction() == FACTION_HOSTILE && !(*j)->isOut())
+					{
+						int d = _save->getTileEngine()->distance(victim->getPosition(), (*j)->getPosition());
+						if (d < closest)
+						{
+							revenger = (*j);
+							closest = d;
+						}
+					}
+				}
+				if (revenger && (revenger->getUnit()->getAggression() == 2 || (revenger->getUnit()->getAggression() == 1 && RNG::generate(RNG::STREAM_AI, 0,100) < 50)))
+				{
+					AggroBAIState *aggro = dynamic_cast<AggroBAIState*>(revenger->getCurrentAIState());
+					if (aggro == 0)
+					{
+						aggro = new AggroBAIState(_save, revenger);
+						revenger->setAIState(aggro);
+					}
+					aggro->setAggroTarget(murderer);
+				}
+			}
+
+			if (victim->getStatus() == STATUS_DEAD && victim->getUnit()->getSpecialAbility() == SPECAB_EXPLODEONDEATH)
+			{
+				explode(Position(victim->getPosition().x * 16, victim->getPosition().y * 16, victim->getPosition().z * 24), 0, victim, 0);
+			}
+		}
+	}
+}
+
+/**
+ * Removes a fallen unit from the map and leaves its corpse
+ * and inventory on the ground, like UnitDieBState.
+ * @param unit Pointer to the unit.
+ */
+void BattleSimulator::convertUnitToCorpse(BattleUnit *unit)
+{
+	// in case the unit was unconscious
+	_save->removeUnconsciousBodyItem(unit);
+
+	int size = unit->getUnit()->getArmor()->getSize() - 1;
+	// move inventory from unit to the ground for non-large units
+	if (size == 0)
+	{
+		for (std::vector<BattleItem*>::iterator i = unit->getInventory()->begin(); i != unit->getInventory()->end(); ++i)
+		{
+			dropItem(unit->getPosition(), (*i));
+		}
+	}
+	unit->getInventory()->clear();
+
+	// remove unit-tile link
+	unit->setTile(0);
+	_save->getPathfinding()->invalidateReachable();
+
+	if (size == 0)
+	{
+		_save->getTile(unit->getPosition())->setUnit(0);
+		BattleItem *corpse = new BattleItem(_rules->getItem(unit->getUnit()->getArmor()->getCorpseItem()), _save->getCurrentItemId());
+		corpse->setUnit(unit);
+		dropItem(unit->getPosition(), corpse, true);
+	}
+	else
+	{
+		int i = 1;
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				_save->getTile(unit->getPosition() + Position(x,y,0))->setUnit(0);
+				std::stringstream ss;
+				ss << unit->getUnit()->getArmor()->getCorpseItem() << i;
+				BattleItem *corpse = new BattleItem(_rules->getItem(ss.str()), _save->getCurrentItemId());
+				dropItem(unit->getPosition() + Position(x,y,0), corpse, true);
+				i++;
+			}
+		}
+	}
+	_save->getTileEngine()->calculateUnitLighting();
+}
+
+/**
+ * Drops an item to the ground, affected by gravity.
+ * @param position Position to drop it at.
+ * @param item Pointer to the item.
+ * @param newItem Whether the item has to be added to the battle's item list.
+ */
+void BattleSimulator::dropItem(const Position &position, BattleItem *item, bool newItem)
+{
+	Position p = position;
+
+	// don't spawn anything outside of bounds
+	if (_save->getTile(p) == 0)
+		return;
+
+	while (_save->getTile(p)->getMapData(MapData::O_FLOOR) == 0 && p.z > 0)
+	{
+		p.z--;
+	}
+
+	_save->getTile(p)->addItem(item);
+
+	if (newItem)
+	{
+		_save->getItems()->push_back(item);
+	}
+
+	item->setSlot(_rules->getInventory("STR_GROUND"));
+	item->setOwner(0);
+
+	if (item->getRules()->getBattleType() == BT_FLARE)
+	{
+		_save->getTileEngine()->calculateTerrainLighting();
+	}
+}
+
+/**
+ * Recalculates the field of view of a unit. X-Com soldiers
+ * aggro on newly spotted units just like the aliens do.
+ * @param unit Pointer to the unit.
+ * @return True if new units were spotted.
+ */
+bool BattleSimulator::calculateFOV(BattleUnit *unit)
+{
+	bool spotted = _save->getTileEngine()->calculateFOV(unit);
+
+	if (spotted && unit->getFaction() != FACTION_HOSTILE)
+	{
+		AggroBAIState *aggro = dynamic_cast<AggroBAIState*>(unit->getCurrentAIState());
+		if (aggro == 0)
+		{
+			aggro = new AggroBAIState(_save, unit);
+			unit->setAIState(aggro);
+		}
+		aggro->setAggroTarget(unit->getVisibleUnits()->at(0));
+	}
+	return spotted;
+}
+
+/**
+ * Ends the turn: primed grenades go off, ufo doors close
+ * and the other side gets to move.
+ */
+void BattleSimulator::endTurn()
+{
+	// check for hot grenades on the ground
+	bool exploded = true;
+	while (exploded)
+	{
+		exploded = false;
+		for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight() && !exploded; ++i)
+		{
+			Tile *tile = _save->getTiles()[i];
+			for (std::vector<BattleItem*>::iterator it = tile->getInventory()->begin(); it != tile->getInventory()->end(); ++it)
+			{
+				if ((*it)->getRules()->getBattleType() == BT_GRENADE && (*it)->getExplodeTurn() > 0 && (*it)->getExplodeTurn() <= _save->getTurn())
+				{
+					BattleItem *grenade = *it;
+					Position p = Position(tile->getPosition().x*16 + 8, tile->getPosition().y*16 + 8, tile->getPosition().z*24 + tile->getTerrainLevel());
+					_save->removeItem(grenade);
+					explode(p, grenade, grenade->getPreviousOwner(), 0);
+					exploded = true;
+					break;
+				}
+			}
+		}
+	}
+
+	_save->getTileEngine()->closeUfoDoors();
+	_save->endTurn();
+
+	checkForCasualties(0);
+
+	// check for terrain explosions
+	Tile *t = _save->getTileEngine()->checkForTerrainExplosions();
+	if (t)
+	{
+		Position p = Position(t->getPosition().x * 16, t->getPosition().y * 16, t->getPosition().z * 24);
+		explode(p, 0, 0, t);
+	}
+}
+
+/**
+ * Writes the statistics of the simulation so far.
+ * @param out Output stream.
+ * @param seconds Wall clock time the simulation took.
+ */
+void BattleSimulator::report(std::ostream &out, double seconds) const
+{
+	out << std::fixed << std::setprecision(3);
+	out << "Turns: " << getTurns() << std::endl;
+	out << "Actions: " << _actions << ", steps: " << _steps << ", shots: " << _shots << ", casualties: " << _casualties << std::endl;
+	out << "Time: " << seconds << "s";
+	if (seconds > 0)
+	{
+		out << " (" << getTurns() / seconds << " turns/s)";
+	}
+	out << std::endl;
+	// only the battlescape zones, nothing gets drawn here
+	const Profiler::Zone zones[] = { Profiler::ZONE_AI, Profiler::ZONE_PATHFINDING, Profiler::ZONE_TILEENGINE };
+	for (int i = 0; i < 3; ++i)
+	{
+		double time = (Profiler::getTotal(zones[i]) - _startTime[zones[i]]) / 1000000.0;
+		out << "  " << std::setw(12) << std::left << Profiler::getName(zones[i]) << std::right << std::setw(10) << time << "s" << std::endl;
+	}
+	long memory = getPeakMemory();
+	if (memory >= 0)
+	{
+		out << "Peak memory: " << memory << " KB" << std::endl;
+	}
+}
+
+/**
+ * Returns the most memory the process has used so far.
+ * @return Peak resident memory in kilobytes, -1 if unknown.
+ */
+long BattleSimulator::getPeakMemory()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+#endif
+	return -1;
+}
+
+}
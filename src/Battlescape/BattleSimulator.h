@@ -0,0 +1,91 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BATTLESIMULATOR_H
+#define OPENXCOM_BATTLESIMULATOR_H
+
+#include <ostream>
+#include "Position.h"
+#include "BattlescapeGame.h"
+#include "../Engine/Profiler.h"
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+class ResourcePack;
+class Ruleset;
+class BattleUnit;
+class BattleItem;
+class Tile;
+
+/**
+ * Plays out a battle with no screen, sound or animation delays.
+ * Units on both sides are run by the battlescape AI and their actions
+ * are carried out instantly, so the engine can be benchmarked
+ * and left running for thousands of turns unattended.
+ */
+class BattleSimulator
+{
+private:
+	static const int MAX_UNIT_ACTIONS = 2;
+	static const int MAX_DOOR_FRAMES = 8;
+	SavedBattleGame *_save;
+	ResourcePack *_res;
+	Ruleset *_rules;
+	int _startTurn, _actions, _steps, _shots, _casualties;
+	double _startTime[Profiler::ZONE_TOTAL];
+
+	/// Lets the AI of a unit act until it is done for this turn.
+	void playUnit(BattleUnit *unit);
+	/// Walks a unit along its path.
+	void walk(BattleAction &action);
+	/// Fires or throws a weapon.
+	void shoot(BattleAction &action);
+	/// Explodes an item, a tile or a unit.
+	void explode(const Position &center, BattleItem *item, BattleUnit *unit, Tile *tile);
+	/// Checks for new casualties.
+	void checkForCasualties(BattleUnit *murderer);
+	/// Removes a dead or unconscious unit from the map.
+	void convertUnitToCorpse(BattleUnit *unit);
+	/// Drops an item on the ground.
+	void dropItem(const Position &position, BattleItem *item, bool newItem = false);
+	/// Recalculates a unit's field of view.
+	bool calculateFOV(BattleUnit *unit);
+	/// Ends the turn of the current side.
+	void endTurn();
+public:
+	/// Creates a simulator for a battle.
+	BattleSimulator(SavedBattleGame *save, ResourcePack *res, Ruleset *rules);
+	/// Cleans up the simulator.
+	~BattleSimulator();
+	/// Plays the turn of the current side.
+	void playTurn();
+	/// Checks if one of the sides has been wiped out.
+	bool isOver() const;
+	/// Gets the number of full turns played.
+	int getTurns() const;
+	/// Writes the simulation statistics.
+	void report(std::ostream &out, double seconds) const;
+	/// Gets the peak memory usage of the process.
+	static long getPeakMemory();
+};
+
+}
+
+#endif
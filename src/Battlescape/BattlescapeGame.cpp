@@ -22,6 +22,7 @@
 #include "BattlescapeGame.h"
 #include "BattlescapeState.h"
 #include "../Engine/Timer.h"
+#include "../Engine/Profiler.h"
 
 #include "Map.h"
 #include "Camera.h"
@@ -153,6 +154,26 @@ void BattlescapeGame::think()
 	}
 }
 
+/**
+ * Checks if think has work to do on every cycle:
+ * nothing else is happening and it's the aliens' or
+ * civilians' turn, or the player's panicking units
+ * haven't been handled yet.
+ * @return True if there's AI or panic to handle.
+ */
+bool BattlescapeGame::isBusy() const
+{
+	if (!_states.empty())
+	{
+		return false;
+	}
+	if (_save->getSide() != FACTION_PLAYER)
+	{
+		return !_debugPlay;
+	}
+	return !_playerPanicHandled;
+}
+
 void BattlescapeGame::init()
 {
 	if (_save->getSide() == FACTION_PLAYER)
@@ -168,6 +189,7 @@ void BattlescapeGame::init()
  */
 void BattlescapeGame::handleAI(BattleUnit *unit)
 {
+	Profiler::Scope scope(Profiler::ZONE_AI);
 	BattleAIState *ai = unit->getCurrentAIState();
 	if (!ai)
 	{
@@ -376,7 +398,7 @@ bool BattlescapeGame::checkForCasualties(BattleItem *murderweapon, BattleUnit *m
 					{
 						int closest = 1000000;
 						BattleUnit *revenger = 0;
-						bool revenge = RNG::generate(0,100) < 50;
+						bool revenge = RNG::generate(RNG::STREAM_AI, 0,100) < 50;
 						for (std::vector<BattleUnit*>::iterator h = _save->getUnits()->begin(); h != _save->getUnits()->end(); ++h)
 						{
 							if ((*h)->getFaction() == FACTION_HOSTILE && !(*h)->isOut() && (*h) != victim)
@@ -786,7 +808,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 
 	unit->abortTurn(); //makes the unit go to status STANDING :p
 
-	int flee = RNG::generate(0,100);
+	int flee = RNG::generate(RNG::STREAM_AI, 0,100);
 	switch (status)
 	{
 	case STATUS_PANICKING: // 1/2 chance to freeze and 1/2 chance try to flee
@@ -807,7 +829,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 			unit->setCache(0);
 			BattleAction ba;
 			ba.actor = unit;
-			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5), unit->getPosition().y + RNG::generate(-5,5), unit->getPosition().z);
+			ba.target = Position(unit->getPosition().x + RNG::generate(RNG::STREAM_AI, -5,5), unit->getPosition().y + RNG::generate(RNG::STREAM_AI, -5,5), unit->getPosition().z);
 			if (_save->getTile(ba.target)) // only walk towards it when the place exists
 			{
 				_save->getPathfinding()->calculate(ba.actor, ba.target);
@@ -820,7 +842,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 		for (int i= 0; i < 4; i++)
 		{
 			ba.actor = unit;
-			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5), unit->getPosition().y + RNG::generate(-5,5), unit->getPosition().z);
+			ba.target = Position(unit->getPosition().x + RNG::generate(RNG::STREAM_AI, -5,5), unit->getPosition().y + RNG::generate(RNG::STREAM_AI, -5,5), unit->getPosition().z);
 			statePushBack(new UnitTurnBState(this, ba));
 		}
 		for (std::vector<BattleUnit*>::iterator j = unit->getVisibleUnits()->begin(); j != unit->getVisibleUnits()->end(); ++j)
@@ -80,6 +80,8 @@ public:
 	~BattlescapeGame();
 	/// think.
 	void think();
+	/// Checks if there's AI or panic to handle.
+	bool isBusy() const;
 	void init();
 	// playable unit selected?
 	bool playableUnitSelected();
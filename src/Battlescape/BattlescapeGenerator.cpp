@@ -321,6 +321,7 @@ void BattlescapeGenerator::run()
 	int worldshades[8] = { 0, 1, 2, 3, 5, 7, 9 , 15 };
 	_save->setGlobalShade(worldshades[_worldShade]);
 
+	_save->getTileEngine()->calculateTerrainVoxels();
 	_save->getTileEngine()->calculateSunShading();
 	_save->getTileEngine()->calculateTerrainLighting();
 	_save->getTileEngine()->calculateUnitLighting();
@@ -343,7 +344,7 @@ BattleUnit *BattlescapeGenerator::addXCOMUnit(BattleUnit *unit)
 		{
 			_save->setUnitPosition(unit, node->getPosition());
 		}
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(RNG::STREAM_MAPGEN, 0,7));
 	}
 	else
 	{
@@ -377,10 +378,10 @@ void BattlescapeGenerator::deployAliens(RuleAlienRace *race, RuleAlienDeployment
 	{
 		std::string alienName = race->getMember((*d).alienRank);
 		// TODO: make this depend on difficulty level
-		int quantity = (*d).lowQty + RNG::generate(0, (*d).dQty);
+		int quantity = (*d).lowQty + RNG::generate(RNG::STREAM_MAPGEN, 0, (*d).dQty);
 		for (int i = 0; i < quantity; i++)
 		{
-			bool outside = RNG::generate(0,99) < (*d).percentageOutsideUFO;
+			bool outside = RNG::generate(RNG::STREAM_MAPGEN, 0,99) < (*d).percentageOutsideUFO;
 			if (_ufo == 0)
 				outside = false;
 			BattleUnit *unit = addAlien(_game->getRuleset()->getGenUnit(alienName), (*d).alienRank, outside);
@@ -445,7 +446,7 @@ BattleUnit *BattlescapeGenerator::addAlien(RuleGenUnit *rules, int alienRank, bo
 	{
 		_save->setUnitPosition(unit, node->getPosition());
 		unit->setAIState(new PatrolBAIState(_game->getSavedGame()->getBattleGame(), unit, node));
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(RNG::STREAM_MAPGEN, 0,7));
 	}
 
 
@@ -470,7 +471,7 @@ BattleUnit *BattlescapeGenerator::addCivilian(RuleGenUnit *rules)
 	{
 		_save->setUnitPosition(unit, node->getPosition());
 		unit->setAIState(new PatrolBAIState(_game->getSavedGame()->getBattleGame(), unit, node));
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(RNG::STREAM_MAPGEN, 0,7));
 	}
 
 	_save->getUnits()->push_back(unit);
@@ -685,8 +686,8 @@ void BattlescapeGenerator::generateMap()
 		// crafts always consist of 1 mapblock, but can have all sorts of sizes
 		ufoMap = _ufo->getRules()->getBattlescapeTerrainData()->getMapBlocks()->at(0);
 
-		ufoX = RNG::generate(0, (_length / 10) - ufoMap->getWidth() / 10);
-		ufoY = RNG::generate(0, (_width / 10) - ufoMap->getLength() / 10);
+		ufoX = RNG::generate(RNG::STREAM_MAPGEN, 0, (_length / 10) - ufoMap->getWidth() / 10);
+		ufoY = RNG::generate(RNG::STREAM_MAPGEN, 0, (_width / 10) - ufoMap->getLength() / 10);
 
 		for (int i = 0; i < ufoMap->getWidth() / 10; ++i)
 		{
@@ -704,8 +705,8 @@ void BattlescapeGenerator::generateMap()
 		craftMap = _craft->getRules()->getBattlescapeTerrainData()->getMapBlocks()->at(0);
 		while (!placed)
 		{
-			craftX = RNG::generate(0, (_length/10)- craftMap->getWidth() / 10);
-			craftY = RNG::generate(0, (_width/10)- craftMap->getLength() / 10);
+			craftX = RNG::generate(RNG::STREAM_MAPGEN, 0, (_length/10)- craftMap->getWidth() / 10);
+			craftY = RNG::generate(RNG::STREAM_MAPGEN, 0, (_width/10)- craftMap->getLength() / 10);
 			placed = true;
 			// check if this place is ok
 			for (int i = 0; i < craftMap->getWidth() / 10; ++i)
@@ -731,16 +732,16 @@ void BattlescapeGenerator::generateMap()
 	/* determine positioning of the urban terrain roads */
 	if (_save->getMissionType() == "STR_TERROR_MISSION")
 	{
-		bool EWRoad = RNG::generate(0,99) < 33;
+		bool EWRoad = RNG::generate(RNG::STREAM_MAPGEN, 0,99) < 33;
 		bool NSRoad = !EWRoad;
-		bool TwoRoads = RNG::generate(0,99) < 25;
+		bool TwoRoads = RNG::generate(RNG::STREAM_MAPGEN, 0,99) < 25;
 		int roadX = craftX;
 		int roadY = craftY;
 		// make sure the road(s) are not crossing the craftin landing site
 		while (roadX == craftX || roadY == craftY)
 		{
-			roadX = RNG::generate(0, (_length/10)- 1);
-			roadY = RNG::generate(0, (_width/10)- 1);
+			roadX = RNG::generate(RNG::STREAM_MAPGEN, 0, (_length/10)- 1);
+			roadY = RNG::generate(RNG::STREAM_MAPGEN, 0, (_width/10)- 1);
 		}
 		if (TwoRoads)
 		{
@@ -1193,13 +1194,13 @@ void BattlescapeGenerator::explodePowerSources()
 {
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) && _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(0,100) < 75)
+		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) && _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(RNG::STREAM_MAPGEN, 0,100) < 75)
 		{
 			Position pos;
 			pos.x = _save->getTiles()[i]->getPosition().x*16;
 			pos.y = _save->getTiles()[i]->getPosition().y*16;
 			pos.z = (_save->getTiles()[i]->getPosition().z*24) +12;
-			_save->getTileEngine()->explode(pos, 180+RNG::generate(0,70), DT_HE, 11, 0);
+			_save->getTileEngine()->explode(pos, 180+RNG::generate(RNG::STREAM_MAPGEN, 0,70), DT_HE, 11, 0);
 		}
 	}
 }
@@ -20,6 +20,7 @@
 #include <cmath>
 #include <sstream>
 #include "Map.h"
+#include "UnitSpriteCache.h"
 #include "Camera.h"
 #include "BattlescapeState.h"
 #include "NextTurnState.h"
@@ -225,6 +226,15 @@ BattlescapeState::BattlescapeState(Game *game) : State(game), _popups()
 	// Set up objects
 
 	_save = _game->getSavedGame()->getBattleGame();
+
+	// Load the sprites of all the units in the battle in one go
+	std::vector<std::string> sheets;
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		sheets.push_back((*i)->getUnit()->getArmor()->getSpriteSheet());
+	}
+	_game->getResourcePack()->prefetch(sheets);
+
 	_map->init();
 	_map->onMouseClick((ActionHandler)&BattlescapeState::mapClick);
 
@@ -380,6 +390,16 @@ void BattlescapeState::think()
 
 }
 
+/**
+ * Keeps the game cycling while the AI is playing
+ * or there are popups waiting to be shown.
+ * @return True if the game shouldn't sleep.
+ */
+bool BattlescapeState::isBusy() const
+{
+	return !_popups.empty() || _battleGame->isBusy();
+}
+
 /**
  * Processes any clicks on the map to
  * command units.
@@ -917,6 +937,14 @@ void BattlescapeState::handle(Action *action)
 				_save->setDebugMode();
 				debug(L"Debug Mode");
 			}
+			// "u" - show how well units share their sprites
+			if (action->getDetails()->key.keysym.sym == SDLK_u)
+			{
+				UnitSpriteCache *sprites = _map->getUnitSprites();
+				std::wstringstream ss;
+				ss << L"Unit sprites: " << sprites->getHits() << L" hits, " << sprites->getMisses() << L" misses, " << sprites->getSize() << L" cached";
+				debug(ss.str());
+			}
 #endif
 			// "l" - toggle personal lighting
 			if (action->getDetails()->key.keysym.sym == SDLK_l)
@@ -85,6 +85,8 @@ public:
 	void init();
 	/// think
 	void think();
+	/// Checks if the battle has work to do.
+	bool isBusy() const;
 	/// Handler for clicking the map.
 	void mapClick(Action *action);
 	/// Handler for clicking the Unit Up button.
@@ -21,7 +21,7 @@
 #include <fstream>
 #include "Map.h"
 #include "Camera.h"
-#include "UnitSprite.h"
+#include "UnitSpriteCache.h"
 #include "Position.h"
 #include "Pathfinding.h"
 #include "TileEngine.h"
@@ -43,6 +43,7 @@
 #include "../Ruleset/MapDataSet.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/RuleArmor.h"
+#include "../Ruleset/Ruleset.h"
 #include "BattlescapeMessage.h"
 #include "../Savegame/SavedGame.h"
 #include "../Interface/Cursor.h"
@@ -72,7 +73,7 @@ namespace OpenXcom
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _selectorX(0), _selectorY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _visibleMapHeight(visibleMapHeight)
+Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _selectorX(0), _selectorY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _visibleMapHeight(visibleMapHeight), _dirtyAreas(), _tileStates(), _unitAreas(), _explosionAreas(), _drawnSelectedUnit(0), _drawnMapOffset(), _fullRedraw(true), _drawnTerrain(false)
 {
 	_res = _game->getResourcePack();
 	_spriteWidth = _res->getSurfaceSet("BLANKS.PCK")->getFrame(0)->getWidth();
@@ -83,7 +84,10 @@ Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight)
 	_scrollTimer = new Timer(SCROLL_INTERVAL);
 	_scrollTimer->onTimer((SurfaceHandler)&Map::scroll);
 	_camera->setScrollTimer(_scrollTimer);
-
+	_projectileArea.x = _projectileArea.y = 0;
+	_projectileArea.w = _projectileArea.h = 0;
+	_unitSprites = new UnitSpriteCache(_spriteWidth, _spriteHeight, _res->getSurfaceSet("HANDOB.PCK"));
+	_rightHand = _game->getRuleset()->getInventory("STR_RIGHT_HAND");
 }
 
 /**
@@ -99,6 +103,8 @@ Map::~Map()
 	{
 		delete _bullet[i];
 	}
+
+	delete _unitSprites;
 }
 
 /**
@@ -145,19 +151,334 @@ void Map::think()
 }
 
 /**
- * Draws the whole map, part by part.
+ * Draws the map. Only the areas of the screen where something changed since the last
+ * time are drawn again, unless the camera moved, then the whole map is redrawn.
  */
 void Map::draw()
 {
-	Surface::draw();
 	if ((_save->getSelectedUnit() && _save->getSelectedUnit()->getVisible()) || _save->getSelectedUnit() == 0 || _save->getDebugMode() || _projectile || !_explosions.empty())
 	{
-		drawTerrain(this);
+		findDirtyAreas();
+
+		int dirtySize = 0;
+		for (std::vector<SDL_Rect>::const_iterator i = _dirtyAreas.begin(); i != _dirtyAreas.end(); ++i)
+		{
+			dirtySize += i->w * i->h;
+		}
+
+		if (_fullRedraw || !_drawnTerrain || _camera->getMapOffset() != _drawnMapOffset || dirtySize > getWidth() * getHeight() / 2)
+		{
+			Surface::draw();
+			SDL_Rect area;
+			area.x = 0;
+			area.y = 0;
+			area.w = getWidth();
+			area.h = getHeight();
+			_drawnMapOffset = _camera->getMapOffset();
+			drawTerrain(this, area);
+		}
+		else
+		{
+			_redraw = false;
+			for (std::vector<SDL_Rect>::iterator i = _dirtyAreas.begin(); i != _dirtyAreas.end(); ++i)
+			{
+				// every blit is clipped to the dirty area, so tiles overlapping it can't touch anything else
+				SDL_SetClipRect(getSurface(), &(*i));
+				SDL_FillRect(getSurface(), &(*i), 0);
+				drawTerrain(this, *i);
+			}
+			SDL_SetClipRect(getSurface(), 0);
+		}
+		_drawnTerrain = true;
 	}
 	else
 	{
+		Surface::draw();
 		_message->blit(this);
+		_drawnTerrain = false;
 	}
+	_dirtyAreas.clear();
+	_fullRedraw = false;
+}
+
+/**
+ * Compares the tiles, units, projectile and explosions in view with the way they were drawn
+ * last time, and marks the areas of the screen that changed as dirty.
+ */
+void Map::findDirtyAreas()
+{
+	int beginX = 0, endX = _save->getWidth() - 1;
+	int beginY = 0, endY = _save->getLength() - 1;
+	int dummy;
+	Position screenPosition;
+
+	if (_tileStates.size() != (unsigned int)(_save->getWidth() * _save->getLength() * _save->getHeight()))
+	{
+		_tileStates.clear();
+		_tileStates.resize(_save->getWidth() * _save->getLength() * _save->getHeight());
+		_fullRedraw = true;
+	}
+
+	_camera->convertScreenToMap(0, 0, &beginX, &dummy);
+	_camera->convertScreenToMap(getWidth(), 0, &dummy, &beginY);
+	_camera->convertScreenToMap(getWidth(), getHeight(), &endX, &dummy);
+	_camera->convertScreenToMap(0, getHeight(), &dummy, &endY);
+	beginY -= (_camera->getViewHeight() * 2);
+	beginX -= (_camera->getViewHeight() * 2);
+	if (beginX < 0)
+		beginX = 0;
+	if (beginY < 0)
+		beginY = 0;
+
+	for (int itZ = 0; itZ <= _camera->getViewHeight(); itZ++)
+	{
+		for (int itX = beginX; itX <= endX; itX++)
+		{
+			for (int itY = beginY; itY <= endY; itY++)
+			{
+				Position mapPosition = Position(itX, itY, itZ);
+				_camera->convertMapToScreen(mapPosition, &screenPosition);
+				screenPosition += _camera->getMapOffset();
+				if (screenPosition.x > -_spriteWidth && screenPosition.x < getWidth() + _spriteWidth &&
+					screenPosition.y > -_spriteHeight && screenPosition.y < getHeight() + _spriteHeight )
+				{
+					Tile *tile = _save->getTile(mapPosition);
+					TileDrawState state;
+					getTileDrawState(tile, &state);
+					TileDrawState &drawn = _tileStates[_save->getTileIndex(mapPosition)];
+					if (!(state == drawn))
+					{
+						drawn = state;
+						addDirtyArea(screenPosition.x, screenPosition.y - _spriteHeight, _spriteWidth, _spriteHeight * 2);
+					}
+				}
+			}
+		}
+	}
+
+	// units that moved, appeared or disappeared
+	_unitAreas.resize(_save->getUnits()->size());
+	for (unsigned int i = 0; i < _save->getUnits()->size(); ++i)
+	{
+		SDL_Rect area;
+		getUnitArea(_save->getUnits()->at(i), &area);
+		SDL_Rect &drawn = _unitAreas[i];
+		if (area.x != drawn.x || area.y != drawn.y || area.w != drawn.w || area.h != drawn.h)
+		{
+			addDirtyArea(drawn);
+			addDirtyArea(area);
+			drawn = area;
+		}
+	}
+
+	// the arrow moves to the selected unit
+	if (_drawnSelectedUnit != _save->getSelectedUnit())
+	{
+		SDL_Rect area;
+		if (_drawnSelectedUnit)
+		{
+			getUnitArea(_drawnSelectedUnit, &area);
+			addDirtyArea(area);
+		}
+		_drawnSelectedUnit = _save->getSelectedUnit();
+		if (_drawnSelectedUnit)
+		{
+			getUnitArea(_drawnSelectedUnit, &area);
+			addDirtyArea(area);
+		}
+	}
+
+	// projectiles move every frame, clear the old position and draw the new one
+	addDirtyArea(_projectileArea);
+	getProjectileArea(&_projectileArea);
+	addDirtyArea(_projectileArea);
+
+	// explosions animate every frame
+	for (std::vector<SDL_Rect>::const_iterator i = _explosionAreas.begin(); i != _explosionAreas.end(); ++i)
+	{
+		addDirtyArea(*i);
+	}
+	_explosionAreas.clear();
+	for (std::set<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
+	{
+		_camera->convertVoxelToScreen((*i)->getPosition(), &screenPosition);
+		SDL_Rect area;
+		if ((*i)->isBig())
+		{
+			area.x = screenPosition.x - 64;
+			area.y = screenPosition.y - 64;
+			area.w = 128;
+			area.h = 128;
+		}
+		else
+		{
+			area.x = screenPosition.x - 15;
+			area.y = screenPosition.y - 15;
+			area.w = 32;
+			area.h = 40;
+		}
+		_explosionAreas.push_back(area);
+		addDirtyArea(area);
+	}
+}
+
+/**
+ * Marks an area of the screen to be drawn again, merging it with an overlapping dirty area if there is one.
+ * @param area Area in screen coordinates, empty areas are ignored.
+ */
+void Map::addDirtyArea(const SDL_Rect &area)
+{
+	addDirtyArea(area.x, area.y, area.w, area.h);
+}
+
+/**
+ * Marks an area of the screen to be drawn again, merging it with an overlapping dirty area if there is one.
+ * @param x X position in pixels.
+ * @param y Y position in pixels.
+ * @param w Width in pixels.
+ * @param h Height in pixels.
+ */
+void Map::addDirtyArea(int x, int y, int w, int h)
+{
+	// clip to the surface
+	int x2 = std::min(x + w, getWidth()), y2 = std::min(y + h, getHeight());
+	x = std::max(x, 0);
+	y = std::max(y, 0);
+	if (x >= x2 || y >= y2)
+		return;
+
+	for (std::vector<SDL_Rect>::iterator i = _dirtyAreas.begin(); i != _dirtyAreas.end(); ++i)
+	{
+		if (x < i->x + i->w && i->x < x2 && y < i->y + i->h && i->y < y2)
+		{
+			int nx = std::min(x, (int)i->x), ny = std::min(y, (int)i->y);
+			int nx2 = std::max(x2, i->x + i->w), ny2 = std::max(y2, i->y + i->h);
+			_dirtyAreas.erase(i);
+			// the merged area may overlap others now
+			addDirtyArea(nx, ny, nx2 - nx, ny2 - ny);
+			return;
+		}
+	}
+	SDL_Rect area;
+	area.x = x;
+	area.y = y;
+	area.w = x2 - x;
+	area.h = y2 - y;
+	_dirtyAreas.push_back(area);
+}
+
+/**
+ * Marks the tiles under the 3D cursor to be drawn again, on every level up to the displayed one.
+ */
+void Map::addCursorArea()
+{
+	if (_cursorType == CT_NONE)
+		return;
+	Position screenPosition;
+	for (int z = 0; z <= _camera->getViewHeight(); z++)
+	{
+		for (int x = _selectorX - _cursorSize + 1; x <= _selectorX; x++)
+		{
+			for (int y = _selectorY - _cursorSize + 1; y <= _selectorY; y++)
+			{
+				_camera->convertMapToScreen(Position(x, y, z), &screenPosition);
+				screenPosition += _camera->getMapOffset();
+				addDirtyArea(screenPosition.x, screenPosition.y - _spriteHeight, _spriteWidth, _spriteHeight * 2);
+			}
+		}
+	}
+}
+
+/**
+ * Gets everything that decides how a tile is drawn.
+ * @param tile Pointer to the tile.
+ * @param state Pointer to the state to fill in.
+ */
+void Map::getTileDrawState(Tile *tile, TileDrawState *state)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		state->sprites[i] = tile->getSprite(i);
+	}
+	state->shade = tile->getShade();
+	state->discovered = tile->isDiscovered(0) | (tile->isDiscovered(1) << 1) | (tile->isDiscovered(2) << 2);
+	state->marker = tile->getMarkerColor();
+	state->item = tile->getTopItemSprite();
+	// fire and smoke animate with the map
+	state->effects = 0;
+	if (tile->getFire() || tile->getSmoke())
+	{
+		state->effects = (tile->getFire() ? 1 : 0) | (tile->getSmoke() << 1) | (((_animFrame / 2) + tile->getAnimationOffset()) << 16);
+	}
+}
+
+/**
+ * Gets the area of the screen a unit is drawn on, including the arrow over the selected unit.
+ * @param unit Pointer to the unit.
+ * @param area Pointer to the area to fill in, it's empty when the unit isn't drawn.
+ */
+void Map::getUnitArea(BattleUnit *unit, SDL_Rect *area)
+{
+	area->x = area->y = 0;
+	area->w = area->h = 0;
+	if (unit->isOut() || !(unit->getVisible() || _save->getDebugMode()) || unit->getPosition().z > _camera->getViewHeight())
+		return;
+
+	Position screenPosition, offset;
+	int size = unit->getUnit()->getArmor()->getSize() - 1;
+	_camera->convertMapToScreen(unit->getPosition(), &screenPosition);
+	screenPosition += _camera->getMapOffset();
+	calculateWalkingOffset(unit, &offset);
+	area->x = screenPosition.x + offset.x - size * (_spriteWidth / 2);
+	area->y = screenPosition.y + offset.y - _arrow->getHeight() - 8;
+	area->w = _spriteWidth * (size + 1);
+	area->h = _spriteHeight + size * (_spriteWidth / 2) + _arrow->getHeight() + 8;
+}
+
+/**
+ * Gets the area of the screen the projectile and its shadow are drawn on.
+ * @param area Pointer to the area to fill in, it's empty when there is no projectile.
+ */
+void Map::getProjectileArea(SDL_Rect *area)
+{
+	area->x = area->y = 0;
+	area->w = area->h = 0;
+	if (!_projectile)
+		return;
+
+	std::vector<Position> positions;
+	if (_projectile->getItem())
+	{
+		positions.push_back(_projectile->getPosition());
+	}
+	else
+	{
+		for (int i = 1; i <= _projectile->getParticle(0); ++i)
+		{
+			positions.push_back(_projectile->getPosition(1-i));
+		}
+	}
+
+	int lowX = 16000, lowY = 16000, highX = -16000, highY = -16000;
+	Position screenPosition;
+	for (std::vector<Position>::iterator i = positions.begin(); i != positions.end(); ++i)
+	{
+		Position shadow = *i;
+		shadow.z = 0;
+		for (int j = 0; j < 2; ++j)
+		{
+			_camera->convertVoxelToScreen(j == 0 ? *i : shadow, &screenPosition);
+			lowX = std::min(lowX, screenPosition.x);
+			lowY = std::min(lowY, screenPosition.y);
+			highX = std::max(highX, screenPosition.x);
+			highY = std::max(highY, screenPosition.y);
+		}
+	}
+	// thrown items are drawn with their full sprite around the position
+	area->x = lowX - _spriteWidth;
+	area->y = lowY - _spriteHeight;
+	area->w = highX - lowX + _spriteWidth * 2;
+	area->h = highY - lowY + _spriteHeight * 2;
 }
 
 /**
@@ -169,11 +490,13 @@ void Map::draw()
 void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
 	Surface::setPalette(colors, firstcolor, ncolors);
+	_fullRedraw = true;
 	for (std::vector<MapDataSet*>::const_iterator i = _save->getMapDataSets()->begin(); i != _save->getMapDataSets()->end(); ++i)
 	{
 		(*i)->getSurfaceset()->setPalette(colors, firstcolor, ncolors);
 	}
 	_message->setPalette(colors, firstcolor, ncolors);
+	_unitSprites->setPalette(colors, firstcolor, ncolors);
 	_message->setBackground(_res->getSurface("TAC00.SCR"));
 	_message->setFonts(_res->getFont("Big.fnt"), _res->getFont("Small.fnt"));
 	_message->setText(_game->getLanguage()->getString("STR_HIDDEN_MOVEMENT"));
@@ -183,8 +506,9 @@ void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 * Draw the terrain.
 * Keep this function as optimised as possible. It's big to minimise overhead of function calls.
 * @param surface The surface to draw on.
+* @param area Only the tiles overlapping this area of the surface are drawn.
 */
-void Map::drawTerrain(Surface *surface)
+void Map::drawTerrain(Surface *surface, const SDL_Rect &area)
 {
 	int frameNumber = 0;
 	Surface *tmpSurface;
@@ -200,10 +524,10 @@ void Map::drawTerrain(Surface *surface)
 	int tileShade, wallShade;
 
 	// get corner map coordinates to give rough boundaries in which tiles to redraw are
-	_camera->convertScreenToMap(0, 0, &beginX, &dummy);
-	_camera->convertScreenToMap(surface->getWidth(), 0, &dummy, &beginY);
-	_camera->convertScreenToMap(surface->getWidth(), surface->getHeight(), &endX, &dummy);
-	_camera->convertScreenToMap(0, surface->getHeight(), &dummy, &endY);
+	_camera->convertScreenToMap(area.x, area.y, &beginX, &dummy);
+	_camera->convertScreenToMap(area.x + area.w, area.y, &dummy, &beginY);
+	_camera->convertScreenToMap(area.x + area.w, area.y + area.h, &endX, &dummy);
+	_camera->convertScreenToMap(area.x, area.y + area.h, &dummy, &endY);
 	beginY -= (_camera->getViewHeight() * 2);
 	beginX -= (_camera->getViewHeight() * 2);
 	if (beginX < 0)
@@ -258,9 +582,9 @@ void Map::drawTerrain(Surface *surface)
 				_camera->convertMapToScreen(mapPosition, &screenPosition);
 				screenPosition += _camera->getMapOffset();
 
-				// only render cells that are inside the surface
-				if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
-					screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
+				// only render cells that are inside the area
+				if (screenPosition.x > area.x - _spriteWidth && screenPosition.x < area.x + area.w + _spriteWidth &&
+					screenPosition.y > area.y - _spriteHeight && screenPosition.y < area.y + area.h + _spriteHeight )
 				{
 					tile = _save->getTile(mapPosition);
 
@@ -638,6 +962,13 @@ void Map::setSelectorPosition(int mx, int my)
 
 	if (oldX != _selectorX || oldY != _selectorY)
 	{
+		int newX = _selectorX, newY = _selectorY;
+		_selectorX = oldX;
+		_selectorY = oldY;
+		addCursorArea();
+		_selectorX = newX;
+		_selectorY = newY;
+		addCursorArea();
 		_redraw = true;
 	}
 }
@@ -667,6 +998,18 @@ void Map::animate(bool redraw)
 		}
 	}
 
+	// things drawn with the animation frame
+	addCursorArea();
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if ((*i)->getFire() > 0 || *i == _save->getSelectedUnit())
+		{
+			SDL_Rect area;
+			getUnitArea(*i, &area);
+			addDirtyArea(area);
+		}
+	}
+
 	if (redraw) _redraw = true;
 }
 
@@ -797,11 +1140,13 @@ int Map::getTerrainLevel(Position pos, int size)
  */
 void Map::setCursorType(CursorType type, int size)
 {
+	addCursorArea();
 	_cursorType = type;
 	if (_cursorType == CT_NORMAL)
 		_cursorSize = size;
 	else
 		_cursorSize = 1;
+	addCursorArea();
 }
 
 /**
@@ -826,46 +1171,40 @@ void Map::cacheUnits()
 
 /**
  * Check if a certain unit needs to be redrawn.
+ * The unit's sprites come from a cache shared by all units,
+ * so they're only drawn if no other unit looks the same.
  * @param unit Pointer to battleUnit
  */
 void Map::cacheUnit(BattleUnit *unit)
 {
-	UnitSprite *unitSprite = new UnitSprite(_spriteWidth, _spriteHeight, 0, 0);
-	unitSprite->setPalette(this->getPalette());
 	bool invalid, dummy;
 	int numOfParts = unit->getUnit()->getArmor()->getSize() == 1?1:4;
 
 	unit->getCache(&invalid);
 	if (invalid)
 	{
+		BattleItem *handItem = unit->getItem(_rightHand);
+		SurfaceSet *sprites = _res->getSurfaceSet(unit->getUnit()->getArmor()->getSpriteSheet());
 		// 1 or 4 iterations, depending on unit size
 		for (int i = 0; i < numOfParts; i++)
 		{
-			Surface *cache = unit->getCache(&dummy, i);
-			if (!cache) // no cache created yet
-			{
-				cache = new Surface(_spriteWidth, _spriteHeight);
-				cache->setPalette(this->getPalette());
-			}
-			unitSprite->setBattleUnit(unit, i);
-			BattleItem *handItem = unit->getItem("STR_RIGHT_HAND");
-			if (handItem)
-			{
-				unitSprite->setBattleItem(handItem);
-			}
-			else
-			{
-				unitSprite->setBattleItem(0);
-			}
-			unitSprite->setSurfaces(_res->getSurfaceSet(unit->getUnit()->getArmor()->getSpriteSheet()),
-									_res->getSurfaceSet("HANDOB.PCK"));
-			unitSprite->setAnimationFrame(_animFrame);
-			cache->clear();
-			unitSprite->blit(cache);
+			Surface *cache = _unitSprites->getSprite(unit, handItem, sprites, i, _animFrame);
+			_unitSprites->release(unit->getCache(&dummy, i));
 			unit->setCache(cache, i);
 		}
-	}	
-	delete unitSprite;
+		SDL_Rect area;
+		getUnitArea(unit, &area);
+		addDirtyArea(area);
+	}
+}
+
+/**
+ * Returns the cache of unit sprites shared by the units on the map.
+ * @return Pointer to the sprite cache.
+ */
+UnitSpriteCache *Map::getUnitSprites() const
+{
+	return _unitSprites;
 }
 
 /**
@@ -21,6 +21,8 @@
 
 #include "../Engine/InteractiveSurface.h"
 #include <set>
+#include <vector>
+#include "Position.h"
 
 namespace OpenXcom
 {
@@ -29,7 +31,6 @@ class ResourcePack;
 class SavedBattleGame;
 class Surface;
 class MapData;
-class Position;
 class Tile;
 class BattleUnit;
 class BulletSprite;
@@ -38,9 +39,26 @@ class Explosion;
 class BattlescapeMessage;
 class Camera;
 class Timer;
+class UnitSpriteCache;
+class RuleInventory;
 
 enum CursorType { CT_NONE, CT_NORMAL, CT_AIM, CT_PSI, CT_WAYPOINT, CT_THROW };
 
+/**
+ * Everything that decides how a tile looks on the map, to find out which tiles changed since the last draw.
+ */
+struct TileDrawState
+{
+	Surface *sprites[4];
+	int shade, discovered, marker, item, effects;
+	/// Compares two tile states.
+	bool operator==(const TileDrawState &other) const
+	{
+		return sprites[0] == other.sprites[0] && sprites[1] == other.sprites[1] && sprites[2] == other.sprites[2] && sprites[3] == other.sprites[3]
+			&& shade == other.shade && discovered == other.discovered && marker == other.marker && item == other.item && effects == other.effects;
+	}
+};
+
 /**
  * Interactive map of the battlescape
  */
@@ -64,7 +82,23 @@ private:
 	BattlescapeMessage *_message;
 	Camera *_camera;
 	int _visibleMapHeight;
-	void drawTerrain(Surface *surface);
+	std::vector<SDL_Rect> _dirtyAreas;
+	std::vector<TileDrawState> _tileStates;
+	std::vector<SDL_Rect> _unitAreas, _explosionAreas;
+	SDL_Rect _projectileArea;
+	BattleUnit *_drawnSelectedUnit;
+	UnitSpriteCache *_unitSprites;
+	RuleInventory *_rightHand;
+	Position _drawnMapOffset;
+	bool _fullRedraw, _drawnTerrain;
+	void drawTerrain(Surface *surface, const SDL_Rect &area);
+	void findDirtyAreas();
+	void addDirtyArea(const SDL_Rect &area);
+	void addDirtyArea(int x, int y, int w, int h);
+	void addCursorArea();
+	void getTileDrawState(Tile *tile, TileDrawState *state);
+	void getUnitArea(BattleUnit *unit, SDL_Rect *area);
+	void getProjectileArea(SDL_Rect *area);
 	int getTerrainLevel(Position pos, int size);
 public:
 	/// Creates a new map at the specified position and size.
@@ -101,6 +135,8 @@ public:
 	void cacheUnits();
 	/// Cache unit.
 	void cacheUnit(BattleUnit *unit);
+	/// Get the shared cache of unit sprites.
+	UnitSpriteCache *getUnitSprites() const;
 	/// Set projectile
 	void setProjectile(Projectile *projectile);
 	/// Get projectile
@@ -16,14 +16,17 @@
  * You should have received a copy of the GNU General Public License
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <list>
+#include <queue>
+#include <algorithm>
 #include "Pathfinding.h"
 #include "PathfindingNode.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
 #include "../Ruleset/MapData.h"
+#include "../Ruleset/MapDataSet.h"
 #include "../Ruleset/RuleArmor.h"
 #include "../Savegame/BattleUnit.h"
+#include "../Engine/Profiler.h"
 
 namespace OpenXcom
 {
@@ -32,16 +35,16 @@ namespace OpenXcom
  * Sets up a Pathfinding.
  * @param save pointer to SavedBattleGame object.
  */
-Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0), _pathPreviewed(false)
+Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _generation(0), _unit(0), _pathPreviewed(false), _reachable(), _reachableUnit(0), _reachablePosition(), _reachableTUs(0)
 {
 	_size = _save->getHeight() * _save->getLength() * _save->getWidth();
-	/* allocate the array and the objects in it */
-	_nodes = new PathfindingNode*[_size];
+	/* allocate the nodes in one block */
+	_nodes.reserve(_size);
 	int x, y, z;
 	for (int i = 0; i < _size; ++i)
 	{
 		_save->getTileCoords(i, &x, &y, &z);
-		_nodes[i] = new PathfindingNode(Position(x, y, z));
+		_nodes.push_back(PathfindingNode(Position(x, y, z)));
 	}
 }
 
@@ -50,34 +53,58 @@ Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0
  */
 Pathfinding::~Pathfinding()
 {
-	for (int i = 0; i < _size; ++i)
-	{
-		delete _nodes[i];
-	}
-	delete[] _nodes;
 
 }
 
 /**
  * Gets the Node on a given position on the map.
+ * A node that was not used yet in the current search is reset first.
  * @param pos position
  * @return Pointer to node.
  */
 PathfindingNode *Pathfinding::getNode(const Position& pos)
 {
-	return _nodes[_save->getTileIndex(pos)];
+	PathfindingNode *node = &_nodes[_save->getTileIndex(pos)];
+	node->reset(_generation);
+	return node;
+}
+
+/**
+ * Gets the lowest TU cost a single step can have on this map, for the movement
+ * type of the current unit. Used as the base of the A-Star heuristic, so it never
+ * overestimates the remaining cost.
+ * @return TU cost.
+ */
+int Pathfinding::getMinimumStepCost()
+{
+	// flying over a tile without a floor costs 4
+	int minimum = _movementType == MT_FLY ? 4 : 255;
+	for (std::vector<MapDataSet*>::iterator i = _save->getMapDataSets()->begin(); i != _save->getMapDataSets()->end(); ++i)
+	{
+		for (std::vector<MapData*>::iterator j = (*i)->getObjects()->begin(); j != (*i)->getObjects()->end(); ++j)
+		{
+			if ((*j)->getObjectType() == MapData::O_FLOOR)
+			{
+				minimum = std::min(minimum, (*j)->getTUCost(_movementType));
+			}
+		}
+	}
+	return std::max(0, minimum == 255 ? 0 : minimum);
 }
 
 /**
- * Calculate the shortest path using a simple A-Star algorithm.
+ * Calculate the shortest path using the A-Star algorithm.
+ * The open list is a binary heap ordered by TU cost plus an estimate of the remaining
+ * cost, so only the nodes on the way to the destination get expanded.
  * @param unit
  * @param endPosition
  */
 
 void Pathfinding::calculate(BattleUnit *unit, Position endPosition)
 {
-	std::list<PathfindingNode*> openList;
-	PathfindingNode *currentNode, *nextNode;
+	Profiler::Scope scope(Profiler::ZONE_PATHFINDING);
+	std::priority_queue<PathfindingOpenSetEntry> openList;
+	PathfindingNode *currentNode, *nextNode, *endNode;
 	Position currentPos, nextPos, startPosition = unit->getPosition();
 	int tuCost, totalTuCost = 0;
 
@@ -115,19 +142,30 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition)
 
 	_path.clear();
 
-	// reset every node, so we have to check them all
-	for (int i = 0; i < _size; ++i)
-		_nodes[i]->reset();
+	// a new generation invalidates every node without touching them
+	_generation++;
+	int straightCost = getMinimumStepCost();
+	int diagonalCost = (int)((double)straightCost * 1.5);
 
 	// start position is the first one in our "open" list
-	openList.push_back(getNode(startPosition));
-	openList.front()->check(0, 0, 0, 0);
+	currentNode = getNode(startPosition);
+	currentNode->check(0, 0, 0, 0);
+	openList.push(PathfindingOpenSetEntry(0, 0, currentNode));
+	endNode = getNode(endPosition);
 
 	// if the open list is empty, we've reached the end
-	while(!openList.empty())
+	while (!openList.empty())
 	{
-		currentPos = openList.front()->getPosition();
-		currentNode = getNode(currentPos);
+		PathfindingOpenSetEntry entry = openList.top();
+		openList.pop();
+		currentNode = entry._node;
+		// skip entries of nodes that were reached cheaper after they were pushed
+		if (entry._tuCost > currentNode->getTUCost())
+			continue;
+		// nothing left in the open list can beat the path we found
+		if (endNode->isChecked() && entry._cost >= endNode->getTUCost())
+			break;
+		currentPos = currentNode->getPosition();
 		// this algorithm expands in all directions
 		for (int direction = 0; direction < 10; direction++)
 		{
@@ -137,27 +175,27 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition)
 				nextNode = getNode(nextPos);
 				totalTuCost = currentNode->getTUCost() + tuCost;
 				// if we haven't checked this node, or the current cost tu cost is lower than our previous path, push this node in the open list to visit later.
-				if( (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
-					&& // this will keep pushing back nodes, as long as we did not reach the end position or there are still possible shorter paths
-					(!getNode(endPosition)->isChecked() || getNode(endPosition)->getTUCost() > totalTuCost)
-				)
+				if (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
 				{
 					nextNode->check(totalTuCost,
 									currentNode->getStepsNum() + 1,
 									currentNode,
 									direction);
-					openList.push_back(nextNode);
+					// estimate the remaining cost by the cheapest possible steps, ignoring levels
+					int dx = abs(endPosition.x - nextPos.x);
+					int dy = abs(endPosition.y - nextPos.y);
+					int estimate = straightCost * (std::max(dx, dy) - std::min(dx, dy)) + diagonalCost * std::min(dx, dy);
+					openList.push(PathfindingOpenSetEntry(totalTuCost + estimate, totalTuCost, nextNode));
 				}
 			}
 		}
-		openList.pop_front();
 	}
 
-	if(!getNode(endPosition)->isChecked()) return;
+	if(!endNode->isChecked()) return;
 
 	//Backward tracking of the path
-	PathfindingNode* pf = getNode(endPosition);
-	for (int i = getNode(endPosition)->getStepsNum(); i > 0; i--)
+	PathfindingNode* pf = endNode;
+	for (int i = endNode->getStepsNum(); i > 0; i--)
 	{
 		_path.push_back(pf->getPrevDir());
 		pf=pf->getPrevNode();
@@ -346,6 +384,97 @@ void Pathfinding::abortPath()
 	_path.clear();
 }
 
+/**
+ * Calculates the TU cost to every tile a unit can reach with its remaining TUs,
+ * using one Dijkstra search bounded by those TUs. The result is kept until the unit
+ * moves, or until terrain or unit occupancy changes, so asking again is free.
+ * @param unit
+ * @return TU cost per tile index, -1 for tiles out of reach.
+ */
+const std::vector<int> &Pathfinding::getReachable(BattleUnit *unit)
+{
+	int timeUnits = unit->getTimeUnits();
+	// spending TUs without moving only shrinks the reachable area, the costs stay the same
+	if (_reachableUnit == unit && _reachablePosition == unit->getPosition() && timeUnits <= _reachableTUs)
+	{
+		return _reachable;
+	}
+
+	std::priority_queue<PathfindingOpenSetEntry> openList;
+	PathfindingNode *currentNode, *nextNode;
+	Position currentPos, nextPos;
+	int tuCost, totalTuCost;
+
+	_movementType = unit->getUnit()->getArmor()->getMovementType();
+	_unit = unit;
+	_reachable.assign(_size, -1);
+
+	// a new generation invalidates every node without touching them
+	_generation++;
+	currentNode = getNode(unit->getPosition());
+	currentNode->check(0, 0, 0, 0);
+	openList.push(PathfindingOpenSetEntry(0, 0, currentNode));
+
+	while (!openList.empty())
+	{
+		PathfindingOpenSetEntry entry = openList.top();
+		openList.pop();
+		currentNode = entry._node;
+		// skip entries of nodes that were reached cheaper after they were pushed
+		if (entry._tuCost > currentNode->getTUCost())
+			continue;
+		currentPos = currentNode->getPosition();
+		_reachable[_save->getTileIndex(currentPos)] = currentNode->getTUCost();
+		for (int direction = 0; direction < 10; direction++)
+		{
+			tuCost = getTUCost(currentPos, direction, &nextPos, unit);
+			if (tuCost >= 255)
+				continue;
+			totalTuCost = currentNode->getTUCost() + tuCost;
+			if (totalTuCost > timeUnits)
+				continue;
+			nextNode = getNode(nextPos);
+			if (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
+			{
+				nextNode->check(totalTuCost, currentNode->getStepsNum() + 1, currentNode, direction);
+				openList.push(PathfindingOpenSetEntry(totalTuCost, totalTuCost, nextNode));
+			}
+		}
+	}
+
+	_reachableUnit = unit;
+	_reachablePosition = unit->getPosition();
+	_reachableTUs = timeUnits;
+	return _reachable;
+}
+
+/**
+ * Gets the TU cost for a unit to walk to a tile with the TUs it has left.
+ * @param unit
+ * @param position
+ * @return TU cost, -1 if the unit can't get there this turn.
+ */
+int Pathfinding::getReachableCost(BattleUnit *unit, const Position &position)
+{
+	if (position.x < 0 || position.x >= _save->getWidth()
+		|| position.y < 0 || position.y >= _save->getLength()
+		|| position.z < 0 || position.z >= _save->getHeight())
+	{
+		return -1;
+	}
+	int cost = getReachable(unit)[_save->getTileIndex(position)];
+	return cost > unit->getTimeUnits() ? -1 : cost;
+}
+
+/**
+ * Invalidates the reachable tiles, they will be calculated again the next time they are asked for.
+ * Has to be called whenever terrain or the tiles occupied by units change.
+ */
+void Pathfinding::invalidateReachable()
+{
+	_reachableUnit = 0;
+}
+
 
 /*
  * Whether a certain part of a tile blocks movement.
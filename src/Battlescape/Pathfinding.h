@@ -21,6 +21,7 @@
 
 #include <vector>
 #include "Position.h"
+#include "PathfindingNode.h"
 #include "../Ruleset/MapData.h"
 
 namespace OpenXcom
@@ -28,7 +29,6 @@ namespace OpenXcom
 
 class Position;
 class SavedBattleGame;
-class PathfindingNode;
 class Tile;
 class BattleUnit;
 
@@ -39,10 +39,12 @@ class Pathfinding
 {
 private:
 	SavedBattleGame *_save;
-	PathfindingNode **_nodes;
-	int _size;
+	std::vector<PathfindingNode> _nodes;
+	int _size, _generation;
 	std::vector<int> _path;
 	MovementType _movementType;
+	/// Gets the lowest TU cost of a single step for the current movement type.
+	int getMinimumStepCost();
 	/// Gets the node at certain position.
 	PathfindingNode *getNode(const Position& pos);
 	/// whether a tile blocks a certain movementType
@@ -52,6 +54,10 @@ private:
 	bool isOnStairs(const Position &startPosition, const Position &endPosition);
 	BattleUnit *_unit;
 	bool _pathPreviewed;
+	std::vector<int> _reachable;
+	BattleUnit *_reachableUnit;
+	Position _reachablePosition;
+	int _reachableTUs;
 public:
 	static const int DIR_UP = 8;
 	static const int DIR_DOWN = 9;
@@ -75,6 +81,12 @@ public:
 	bool previewPath(bool bRemove = false);
 	bool removePreview();
 	bool bresenhamPath(const Position& origin, const Position& target);
+	/// Calculate the TU cost to every tile a unit can reach with its remaining TUs.
+	const std::vector<int> &getReachable(BattleUnit *unit);
+	/// Get the TU cost for a unit to reach a tile this turn.
+	int getReachableCost(BattleUnit *unit, const Position &position);
+	/// Invalidate the reachable tiles after terrain or unit occupancy changed.
+	void invalidateReachable();
 
 };
 
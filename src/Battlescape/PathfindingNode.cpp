@@ -26,7 +26,7 @@ namespace OpenXcom
  * Sets up a PathfindingNode.
  * @param pos Position.
  */
-PathfindingNode::PathfindingNode(Position pos) : _pos(pos)
+PathfindingNode::PathfindingNode(Position pos) : _pos(pos), _generation(-1), _checked(false)
 {
 
 }
@@ -48,11 +48,17 @@ const Position &PathfindingNode::getPosition() const
 	return _pos;
 }
 /**
- * Reset node.
+ * Reset node. Nodes are reset lazily: each search has its own generation number,
+ * and a node that was last touched by an older search is cleared on first use.
+ * @param generation The generation number of the current search.
  */
-void PathfindingNode::reset()
+void PathfindingNode::reset(int generation)
 {
-	_checked = false;
+	if (_generation != generation)
+	{
+		_generation = generation;
+		_checked = false;
+	}
 }
 /**
 * Check node. The pathfinding marks every node as checked, storing some additional info.
@@ -31,6 +31,7 @@ class PathfindingNode
 {
 private:
 	Position _pos;
+	int _generation;
 	bool _checked;
 	int _tuCost, _stepsNum;
 	PathfindingNode* _prevNode;
@@ -42,8 +43,8 @@ public:
 	~PathfindingNode();
 	/// Get the node position
 	const Position &getPosition() const;
-	/// Reset node.
-	void reset();
+	/// Reset node if it belongs to an older search.
+	void reset(int generation);
 	/// Check node.
 	void check(int tuCost, int stepsNum, PathfindingNode* prevNode, int prevDir);
 	/// is checked?
@@ -58,6 +59,19 @@ public:
 	int getPrevDir() const;
 };
 
+/**
+ * An entry in the open list of the pathfinding, a binary heap with the cheapest entry on top.
+ */
+struct PathfindingOpenSetEntry
+{
+	int _cost, _tuCost;
+	PathfindingNode *_node;
+	/// Creates an open list entry.
+	PathfindingOpenSetEntry(int cost, int tuCost, PathfindingNode *node) : _cost(cost), _tuCost(tuCost), _node(node) {};
+	/// Lower costs get a higher priority.
+	bool operator<(const PathfindingOpenSetEntry &other) const { return _cost > other._cost; }
+};
+
 }
 
 #endif
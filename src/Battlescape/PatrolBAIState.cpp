@@ -20,6 +20,7 @@
 #include <cmath>
 #include "PatrolBAIState.h"
 #include "TileEngine.h"
+#include "Pathfinding.h"
 #include "AggroBAIState.h"
 #include "../Savegame/BattleUnit.h"
 #include "../Savegame/SavedBattleGame.h"
@@ -200,18 +201,32 @@ void PatrolBAIState::think(BattleAction *action)
 			}
 			else
 			{
-				// find closest target which is not already allocated
+				// find closest target which is not already allocated, targets we can reach this turn come first
 				int closest = 1000000;
+				bool reachable = false;
 				for (std::vector<Node*>::iterator i = _game->getNodes()->begin(); i != _game->getNodes()->end(); ++i)
 				{
 					if ((*i)->isTarget() && !(*i)->isAllocated())
 					{
 						node = *i;
-						int d = _game->getTileEngine()->distance(_unit->getPosition(), node->getPosition());
-						if (d < closest)
+						int cost = _game->getPathfinding()->getReachableCost(_unit, node->getPosition());
+						if (cost != -1)
 						{
-							_toNode = node;
-							closest = d;
+							if (!reachable || cost < closest)
+							{
+								_toNode = node;
+								closest = cost;
+								reachable = true;
+							}
+						}
+						else if (!reachable)
+						{
+							int d = _game->getTileEngine()->distance(_unit->getPosition(), node->getPosition());
+							if (d < closest)
+							{
+								_toNode = node;
+								closest = d;
+							}
 						}
 					}
 				}
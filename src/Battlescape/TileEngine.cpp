@@ -19,7 +19,10 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <set>
+#include <algorithm>
+#include <iterator>
 #include "TileEngine.h"
+#include "Pathfinding.h"
 #include "SDL.h"
 #include "BattleAIState.h"
 #include "AggroBAIState.h"
@@ -29,6 +32,7 @@
 #include "../Savegame/Soldier.h"
 #include "../Savegame/GenUnit.h"
 #include "../Engine/RNG.h"
+#include "../Engine/Profiler.h"
 #include "../Ruleset/MapDataSet.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/RuleGenUnit.h"
@@ -45,7 +49,7 @@ namespace OpenXcom
  */
 TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true)
 {
-
+	initViewFan();
 }
 
 /**
@@ -57,22 +61,160 @@ TileEngine::~TileEngine()
 }
 
 
+/**
+ * Precomputes the ray fan used for the field of view. For every tile offset within
+ * viewing distance this stores the previous tile on the bresenham line back to the
+ * viewer, so a tile is visible when its parent is visible and nothing blocks the step
+ * between them. For each direction the offsets inside the view cone are listed
+ * ordered by distance, so parents are always handled before their children.
+ */
+void TileEngine::initViewFan()
+{
+	int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
+	int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
+	int height = _save->getHeight();
+
+	_viewFanParent.resize(VIEW_FAN_SIZE * VIEW_FAN_SIZE * (height * 2 - 1), -1);
+	_viewFanVisible.resize(_viewFanParent.size(), 0);
+
+	for (int z = 1 - height; z < height; ++z)
+	{
+		for (int y = -MAX_VIEW_DISTANCE; y <= MAX_VIEW_DISTANCE; ++y)
+		{
+			for (int x = -MAX_VIEW_DISTANCE; x <= MAX_VIEW_DISTANCE; ++x)
+			{
+				// walk the same bresenham line as calculateLine does and remember the second last point
+				int p[3] = {0, 0, 0}, d[3] = {x, y, z}, step[3], delta[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					step[i] = d[i] < 0 ? -1 : 1;
+					delta[i] = abs(d[i]);
+				}
+				int swap_xy = delta[1] > delta[0];
+				int a = swap_xy ? 1 : 0, b = swap_xy ? 0 : 1;
+				int swap_xz = delta[2] > delta[a];
+				int major = swap_xz ? 2 : a;
+				int minor1 = b, minor2 = swap_xz ? a : 2;
+				int drift1 = delta[major] / 2, drift2 = delta[major] / 2;
+				Position last(0, 0, 0);
+				for (int n = 0; n < delta[major]; ++n)
+				{
+					last = Position(p[0], p[1], p[2]);
+					drift1 -= delta[minor1];
+					drift2 -= delta[minor2];
+					if (drift1 < 0)
+					{
+						p[minor1] += step[minor1];
+						drift1 += delta[major];
+					}
+					if (drift2 < 0)
+					{
+						p[minor2] += step[minor2];
+						drift2 += delta[major];
+					}
+					p[major] += step[major];
+				}
+				if (x || y || z)
+				{
+					_viewFanParent[viewFanIndex(x, y, z)] = viewFanIndex(last.x, last.y, last.z);
+				}
+			}
+		}
+	}
+
+	for (int dir = 0; dir < 8; ++dir)
+	{
+		bool swap = (dir == 0 || dir == 4);
+		std::vector<std::vector<int> > rings(MAX_VIEW_DISTANCE + height);
+		_viewConeMask[dir].resize(VIEW_FAN_SIZE * VIEW_FAN_SIZE, false);
+		for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
+		{
+			int y1 = (dir % 2) ? 0 : -x;
+			int y2 = (dir % 2) ? MAX_VIEW_DISTANCE - x : x;
+			for (int y = y1; y <= y2; ++y)
+			{
+				if (int(floor(sqrt(float(x*x + y*y)) + 0.5)) > MAX_VIEW_DISTANCE)
+					continue;
+				int dx = signX[dir]*(swap?y:x);
+				int dy = signY[dir]*(swap?x:y);
+				_viewConeMask[dir][(dy + MAX_VIEW_DISTANCE) * VIEW_FAN_SIZE + dx + MAX_VIEW_DISTANCE] = true;
+				for (int dz = 1 - height; dz < height; ++dz)
+				{
+					int ring = std::max(std::max(abs(dx), abs(dy)), abs(dz));
+					rings[ring].push_back(viewFanIndex(dx, dy, dz));
+				}
+			}
+		}
+		for (std::vector<std::vector<int> >::iterator i = rings.begin(); i != rings.end(); ++i)
+		{
+			_viewCone[dir].insert(_viewCone[dir].end(), i->begin(), i->end());
+		}
+	}
+}
+
+/**
+ * Converts a tile offset relative to the viewer into an index of the view fan.
+ * @param x Offset on the x axis.
+ * @param y Offset on the y axis.
+ * @param z Offset on the z axis.
+ * @return Index in the view fan.
+ */
+int TileEngine::viewFanIndex(int x, int y, int z) const
+{
+	return ((z + _save->getHeight() - 1) * VIEW_FAN_SIZE + y + MAX_VIEW_DISTANCE) * VIEW_FAN_SIZE + x + MAX_VIEW_DISTANCE;
+}
+
+/**
+ * Converts an index of the view fan back to a tile offset relative to the viewer.
+ * @param index Index in the view fan.
+ * @return Offset.
+ */
+Position TileEngine::viewFanOffset(int index) const
+{
+	return Position(index % VIEW_FAN_SIZE - MAX_VIEW_DISTANCE,
+		(index / VIEW_FAN_SIZE) % VIEW_FAN_SIZE - MAX_VIEW_DISTANCE,
+		index / (VIEW_FAN_SIZE * VIEW_FAN_SIZE) - (_save->getHeight() - 1));
+}
+
 /**
   * Calculate sun shading for the whole terrain.
   */
 void TileEngine::calculateSunShading()
+{
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
+	calculateSunShading(Position(_save->getWidth() / 2, _save->getLength() / 2, 0), std::max(_save->getWidth(), _save->getLength()));
+}
+
+/**
+  * Calculate sun shading for the columns of tiles within a square range of a position,
+  * for example after an explosion destroyed some roofs.
+  * @param position Center of the area to update.
+  * @param radius Number of columns on each side of the center to update.
+  */
+void TileEngine::calculateSunShading(const Position &position, int radius)
 {
 	const int layer = 0; // Ambient lighting layer.
 
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
+	_roofLevel.resize(_save->getWidth() * _save->getLength(), -1);
+
+	for (int x = std::max(0, position.x - radius); x <= std::min(_save->getWidth() - 1, position.x + radius); ++x)
 	{
-		_save->getTiles()[i]->resetLight(layer);
-		calculateSunShading(_save->getTiles()[i]);
+		for (int y = std::max(0, position.y - radius); y <= std::min(_save->getLength() - 1, position.y + radius); ++y)
+		{
+			updateRoofLevel(x, y);
+			for (int z = 0; z < _save->getHeight(); ++z)
+			{
+				Tile *tile = _save->getTile(Position(x, y, z));
+				tile->resetLight(layer);
+				calculateSunShading(tile);
+			}
+		}
 	}
 }
 
 /**
   * Calculate sun shading for 1 tile. Sun comes from above and is blocked by floors or objects.
+  * Uses the roof level cached for the tile's column.
   * @param tile The tile to calculate sun shading for.
   */
 void TileEngine::calculateSunShading(Tile *tile)
@@ -84,7 +226,7 @@ void TileEngine::calculateSunShading(Tile *tile)
 	// At night/dusk sun isn't dropping shades blocked by roofs
 	if (_save->getGlobalShade() <= 4)
 	{
-		if (verticalBlockage(_save->getTile(Position(tile->getPosition().x, tile->getPosition().y, _save->getHeight() - 1)), tile, DT_NONE))
+		if (tile->getPosition().z < _roofLevel[tile->getPosition().y * _save->getWidth() + tile->getPosition().x])
 		{
 			power -= 2;
 		}
@@ -93,51 +235,110 @@ void TileEngine::calculateSunShading(Tile *tile)
 	tile->addLight(power, layer);
 }
 
+/**
+  * Finds the highest floor in a column that blocks the sun, everything below it is in the shade.
+  * @param x X coordinate of the column.
+  * @param y Y coordinate of the column.
+  */
+void TileEngine::updateRoofLevel(int x, int y)
+{
+	int roof = -1;
+	for (int z = _save->getHeight() - 1; z > 0 && roof == -1; --z)
+	{
+		if (blockage(_save->getTile(Position(x, y, z)), MapData::O_FLOOR, DT_NONE))
+		{
+			roof = z;
+		}
+	}
+	_roofLevel[y * _save->getWidth() + x] = roof;
+}
+
+/**
+ * Calculates the voxel occupancy of the terrain of the whole map. Every tile gets the
+ * rows of its LOFTs merged into one bit mask per row, so voxelCheck only has to look up
+ * the actual objects when a voxel is hit.
+ */
+void TileEngine::calculateTerrainVoxels()
+{
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
+	int size = _save->getWidth() * _save->getLength() * _save->getHeight();
+	_terrainVoxels.assign(size * VOXEL_ROWS_PER_TILE, 0);
+	for (int i = 0; i < size; ++i)
+	{
+		updateTerrainVoxels(_save->getTiles()[i]);
+	}
+}
+
+/**
+ * Updates the voxel occupancy of a single tile, has to be called whenever objects on the tile
+ * are destroyed or doors are opened or closed.
+ * @param tile The tile to update.
+ */
+void TileEngine::updateTerrainVoxels(Tile *tile)
+{
+	if (_terrainVoxels.empty())
+		return;
+	Uint16 *rows = &_terrainVoxels[_save->getTileIndex(tile->getPosition()) * VOXEL_ROWS_PER_TILE];
+	for (int layer = 0; layer < 12; ++layer)
+	{
+		for (int y = 0; y < 16; ++y)
+		{
+			Uint16 row = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				MapData *mp = tile->getMapData(i);
+				if (mp != 0 && !tile->isUfoDoorOpen(i))
+				{
+					row |= (*_voxelData)[mp->getLoftID(layer) * 16 + y];
+				}
+			}
+			rows[layer * 16 + y] = row;
+		}
+	}
+}
+
 /**
   * Recalculate lighting for the terrain: objects,items,fire.
   */
 void TileEngine::calculateTerrainLighting()
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	const int layer = 1; // Static lighting layer.
 	const int fireLightPower = 15; // amount of light a fire generates
+	std::vector<LightSource> sources;
 
-	// reset all light to 0 first
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
+		Tile *tile = _save->getTiles()[i];
 
-	// add lighting of terrain
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
-	{
 		// only floors and objects can light up
-		if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR)
-			&& _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource())
+		if (tile->getMapData(MapData::O_FLOOR)
+			&& tile->getMapData(MapData::O_FLOOR)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource(), layer);
+			sources.push_back(LightSource(tile->getPosition(), tile->getMapData(MapData::O_FLOOR)->getLightSource()));
 		}
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT)
-			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource())
+		if (tile->getMapData(MapData::O_OBJECT)
+			&& tile->getMapData(MapData::O_OBJECT)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource(), layer);
+			sources.push_back(LightSource(tile->getPosition(), tile->getMapData(MapData::O_OBJECT)->getLightSource()));
 		}
 
 		// fires
-		if (_save->getTiles()[i]->getFire())
+		if (tile->getFire())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), fireLightPower, layer);
+			sources.push_back(LightSource(tile->getPosition(), fireLightPower));
 		}
 
-		for (std::vector<BattleItem*>::iterator it = _save->getTiles()[i]->getInventory()->begin(); it != _save->getTiles()[i]->getInventory()->end(); ++it)
+		for (std::vector<BattleItem*>::iterator it = tile->getInventory()->begin(); it != tile->getInventory()->end(); ++it)
 		{
 			if ((*it)->getRules()->getBattleType() == BT_FLARE)
 			{
-				addLight(_save->getTiles()[i]->getPosition(), (*it)->getRules()->getPower(), layer);
+				sources.push_back(LightSource(tile->getPosition(), (*it)->getRules()->getPower()));
 			}
 		}
-
 	}
 
+	updateLightSources(sources, layer);
 }
 
 /**
@@ -145,14 +346,10 @@ void TileEngine::calculateTerrainLighting()
   */
 void TileEngine::calculateUnitLighting()
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	const int layer = 2; // Dynamic lighting layer.
 	const int personalLightPower = 15; // amount of light a unit generates
-
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
-	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
+	std::vector<LightSource> sources;
 
 	if (_personalLighting)
 	{
@@ -161,7 +358,61 @@ void TileEngine::calculateUnitLighting()
 		{
 			if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
 			{
-				addLight((*i)->getPosition(), personalLightPower, layer);
+				sources.push_back(LightSource((*i)->getPosition(), personalLightPower));
+			}
+		}
+	}
+
+	updateLightSources(sources, layer);
+}
+
+/**
+ * Replaces the light sources of a layer. Only the columns within reach of the light sources
+ * that were added, removed or changed since the last update are relit, so a unit taking a step
+ * or a fire going out does not relight the whole map.
+ * @param sources The new light sources of the layer, this vector is consumed.
+ * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ */
+void TileEngine::updateLightSources(std::vector<LightSource> &sources, int layer)
+{
+	std::vector<LightSource> changed;
+
+	std::sort(sources.begin(), sources.end());
+	std::set_symmetric_difference(_lightSources[layer].begin(), _lightSources[layer].end(), sources.begin(), sources.end(), std::back_inserter(changed));
+	_lightSources[layer].swap(sources);
+
+	if (changed.empty())
+		return;
+
+	// mark the columns the changed lights could reach and reset their light
+	_dirtyColumns.assign(_save->getWidth() * _save->getLength(), false);
+	for (std::vector<LightSource>::iterator i = changed.begin(); i != changed.end(); ++i)
+	{
+		for (int x = std::max(0, i->position.x - i->power); x <= std::min(_save->getWidth() - 1, i->position.x + i->power); ++x)
+		{
+			for (int y = std::max(0, i->position.y - i->power); y <= std::min(_save->getLength() - 1, i->position.y + i->power); ++y)
+			{
+				if (_dirtyColumns[y * _save->getWidth() + x])
+					continue;
+				_dirtyColumns[y * _save->getWidth() + x] = true;
+				for (int z = 0; z < _save->getHeight(); ++z)
+				{
+					_save->getTile(Position(x, y, z))->resetLight(layer);
+				}
+			}
+		}
+	}
+
+	// relight them with every light that overlaps a changed one
+	for (std::vector<LightSource>::iterator i = _lightSources[layer].begin(); i != _lightSources[layer].end(); ++i)
+	{
+		for (std::vector<LightSource>::iterator j = changed.begin(); j != changed.end(); ++j)
+		{
+			if (abs(i->position.x - j->position.x) <= i->power + j->power
+				&& abs(i->position.y - j->position.y) <= i->power + j->power)
+			{
+				addLight(i->position, i->power, layer);
+				break;
 			}
 		}
 	}
@@ -169,32 +420,37 @@ void TileEngine::calculateUnitLighting()
 
 /**
  * Adds circular light pattern starting from center and loosing power with distance travelled.
+ * Only the columns marked dirty by updateLightSources are lit.
  * @param center
  * @param power
  * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
  */
 void TileEngine::addLight(const Position &center, int power, int layer)
 {
+	int signX[4] = { +1, -1, -1, +1 };
+	int signY[4] = { +1, -1, +1, -1 };
+
 	// only loop through the positive quadrant.
 	for (int x = 0; x <= power; ++x)
 	{
 		for (int y = 0; y <= power; ++y)
 		{
-			for (int z = 0; z < _save->getHeight(); z++)
-			{
-				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
-
-				if (_save->getTile(Position(center.x + x,center.y + y, z)))
-					_save->getTile(Position(center.x + x,center.y + y, z))->addLight(power - distance, layer);
+			int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
+			if (distance >= power)
+				continue;
 
-				if (_save->getTile(Position(center.x - x,center.y - y, z)))
-					_save->getTile(Position(center.x - x,center.y - y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y + y, z)))
-					_save->getTile(Position(center.x - x,center.y + y, z))->addLight(power - distance, layer);
+			for (int quadrant = 0; quadrant < 4; ++quadrant)
+			{
+				int tx = center.x + signX[quadrant] * x;
+				int ty = center.y + signY[quadrant] * y;
+				if (tx < 0 || ty < 0 || tx >= _save->getWidth() || ty >= _save->getLength()
+					|| !_dirtyColumns[ty * _save->getWidth() + tx])
+					continue;
 
-				if (_save->getTile(Position(center.x + x,center.y - y, z)))
-					_save->getTile(Position(center.x + x,center.y - y, z))->addLight(power - distance, layer);
+				for (int z = 0; z < _save->getHeight(); z++)
+				{
+					_save->getTile(Position(tx, ty, z))->addLight(power - distance, layer);
+				}
 			}
 		}
 	}
@@ -203,18 +459,18 @@ void TileEngine::addLight(const Position &center, int power, int layer)
 
 /**
  * Calculates line of sight of a soldier.
+ * Tiles are discovered in a single pass over the precomputed view fan, and only
+ * when the unit moved, turned or the terrain in its view changed. Visible units are
+ * checked each time, but only the units standing inside the view cone are traced.
  * @param unit
  * @return true when new aliens spotted
  */
 bool TileEngine::calculateFOV(BattleUnit *unit)
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	int visibleUnitsChecksum = 0;
 	Position center = unit->getPosition();
-	Position test;
-	bool swap = (unit->getDirection()==0 || unit->getDirection()==4);
-	int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
-	int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
-	int y1, y2;
+	int direction = unit->getDirection();
 
 	// calculate a visible units checksum - if it changed during this step, the soldier stops walking
 	for (std::vector<BattleUnit*>::iterator i = unit->getVisibleUnits()->begin(); i != unit->getVisibleUnits()->end(); ++i)
@@ -225,51 +481,76 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 	if (unit->isOut())
 		return false;
 
-	for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
+	// only units of the opposing factions within view distance can be seen (large units reach one tile further)
+	std::vector<BattleUnit*> units;
+	if (unit->getFaction() == FACTION_PLAYER)
 	{
-		if (unit->getDirection()%2)
-		{
-			y1 = 0;
-			y2 = MAX_VIEW_DISTANCE - x;
-		}
-		else
+		_save->getUnitsInRange(center, MAX_VIEW_DISTANCE + 1, FACTION_HOSTILE, &units);
+	}
+	else if (unit->getFaction() == FACTION_HOSTILE)
+	{
+		_save->getUnitsInRange(center, MAX_VIEW_DISTANCE + 1, FACTION_PLAYER, &units);
+		_save->getUnitsInRange(center, MAX_VIEW_DISTANCE + 1, FACTION_NEUTRAL, &units);
+	}
+
+	for (std::vector<BattleUnit*>::iterator i = units.begin(); i != units.end(); ++i)
+	{
+		BattleUnit *visibleUnit = *i;
+		if (visibleUnit->isOut() ||
+			!((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() == FACTION_PLAYER)
+			|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE)))
 		{
-			y1 = -x;
-			y2 = x;
+			continue;
 		}
-		for (int y = y1; y <= y2; ++y)
+		// large units are seen as soon as one of their tiles is visible
+		int size = visibleUnit->getUnit()->getArmor()->getSize();
+		for (int x = 0; x < size; ++x)
 		{
-			for (int z = 0; z < _save->getHeight(); z++)
+			for (int y = 0; y < size; ++y)
 			{
-				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
-				test.z = z;
-				if (distance <= MAX_VIEW_DISTANCE)
+				Position offset = visibleUnit->getPosition() + Position(x, y, 0) - center;
+				if (abs(offset.x) > MAX_VIEW_DISTANCE || abs(offset.y) > MAX_VIEW_DISTANCE
+					|| !_viewConeMask[direction][(offset.y + MAX_VIEW_DISTANCE) * VIEW_FAN_SIZE + offset.x + MAX_VIEW_DISTANCE])
 				{
-					test.x = center.x + signX[unit->getDirection()]*(swap?y:x);
-					test.y = center.y + signY[unit->getDirection()]*(swap?x:y);
-					if (_save->getTile(test))
-					{
-						BattleUnit *visibleUnit = _save->getTile(test)->getUnit();
-						if (visibleUnit && !visibleUnit->isOut() && visible(unit, _save->getTile(test)))
-						{
-							if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() == FACTION_PLAYER)
-								|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
-							{
-								unit->addToVisibleUnits(visibleUnit);
-							}
-						}
-
-						if (unit->getFaction() == FACTION_PLAYER)
-						{
-							// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
-							calculateLine(unit->getPosition(), test, false, 0, unit, false);
-						}
-					}
+					continue;
+				}
+				if (visible(unit, _save->getTile(center + offset)))
+				{
+					unit->addToVisibleUnits(visibleUnit);
 				}
 			}
 		}
 	}
 
+	if (unit->getFaction() == FACTION_PLAYER && !unit->getFovCached())
+	{
+		// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
+		std::fill(_viewFanVisible.begin(), _viewFanVisible.end(), 0);
+		for (std::vector<int>::const_iterator i = _viewCone[direction].begin(); i != _viewCone[direction].end(); ++i)
+		{
+			Tile *tile = _save->getTile(center + viewFanOffset(*i));
+			if (!tile)
+				continue;
+			int parent = _viewFanParent[*i];
+			if (parent != -1)
+			{
+				if (!_viewFanVisible[parent])
+					continue;
+				Tile *from = _save->getTile(center + viewFanOffset(parent));
+				if (horizontalBlockage(from, tile, DT_NONE) + verticalBlockage(from, tile, DT_NONE) != 0)
+					continue;
+			}
+			_viewFanVisible[*i] = 1;
+			tile->setDiscovered(true, 2);
+			// walls to the east or south of a visible tile, we see that too
+			Tile* t = _save->getTile(tile->getPosition() + Position(1, 0, 0));
+			if (t) t->setDiscovered(true, 0);
+			t = _save->getTile(tile->getPosition() + Position(0, 1, 0));
+			if (t) t->setDiscovered(true, 1);
+		}
+		unit->setFovCached(true);
+	}
+
 	int newChecksum = 0;
 	for (std::vector<BattleUnit*>::iterator i = unit->getVisibleUnits()->begin(); i != unit->getVisibleUnits()->end(); ++i)
 		newChecksum += (*i)->getId()+1;
@@ -311,7 +592,6 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
 
 	// determine the origin and target voxels for the raytrace
 	Position originVoxel, targetVoxel;
-	std::vector<Position> _trajectory;
 	originVoxel = Position((currentUnit->getPosition().x * 16) + 8, (currentUnit->getPosition().y * 16) + 8, currentUnit->getPosition().z*24);
 	originVoxel.z += -_save->getTile(currentUnit->getPosition())->getTerrainLevel();
 	originVoxel.z += currentUnit->getHeight();
@@ -331,53 +611,26 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
 		targetMaxHeight += 12;
 	}
 
-	// scan ray from top to bottom
-	for (int i = targetMaxHeight; i > targetMinHeight; i-=2)
+	// scan rays from top to bottom, all at once
+	VoxelRay rays[MAX_VISIBILITY_RAYS];
+	int count = 0;
+	for (int i = targetMaxHeight; i > targetMinHeight && count < MAX_VISIBILITY_RAYS; i-=2)
 	{
-		targetVoxel.z = i;
-		_trajectory.clear();
-		int test = calculateLine(originVoxel, targetVoxel, false, &_trajectory, currentUnit);
-		if (test == 4)
-		{
-			Position hitPosition = Position(_trajectory.at(0).x/16, _trajectory.at(0).y/16, _trajectory.at(0).z/24);
-			if (tile->getPosition() == hitPosition)
-			{
-				unitSeen = true;
-				break;
-			}
-		}
-		if (test == -1)
-		{
-			unitSeen = true;
-			break;
-		}
+		rays[count].target = Position(targetVoxel.x, targetVoxel.y, i);
+		count++;
 	}
+	int ray = traceRays(originVoxel, rays, count, currentUnit, tile);
 
-	if (unitSeen)
+	if (ray != -1)
 	{
 		// now check if we really see it taking into account smoke tiles
 		// initial smoke "density" of a smoke grenade is around 10 per tile
 		// we do density/2 to get the decay of visibility, so in fresh smoke we only have 4 tiles of visibility
-		_trajectory.clear();
-		calculateLine(originVoxel, targetVoxel, true, &_trajectory, currentUnit);
-		Tile *t = _save->getTile(currentUnit->getPosition());
-		int maxViewDistance = MAX_VIEW_DISTANCE - (t->getSmoke()/2);
-		for (unsigned int i = 0; i < _trajectory.size(); i++)
-		{
-			if (t != _save->getTile(Position(_trajectory.at(i).x/16,_trajectory.at(i).y/16, _trajectory.at(i).z/24)))
-			{
-				t = _save->getTile(Position(_trajectory.at(i).x/16,_trajectory.at(i).y/16, _trajectory.at(i).z/24));
-				maxViewDistance -= t->getSmoke()/2;
-			}
-		}
+		int maxViewDistance = MAX_VIEW_DISTANCE - rays[ray].smoke;
 		if (distance(currentUnit->getPosition(), tile->getPosition()) <= maxViewDistance)
 		{
 			unitSeen = true;
 		}
-		else
-		{
-			unitSeen = false;
-		}
 	}
 
 	return unitSeen;
@@ -389,11 +642,23 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
  */
 void TileEngine::calculateFOV(const Position &position)
 {
-	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
+	// distance() rounds, so units closer than 20 tiles are at most 19 tiles away along each axis
+	std::vector<BattleUnit*> units;
+	for (int faction = FACTION_PLAYER; faction <= FACTION_NEUTRAL; ++faction)
+	{
+		_save->getUnitsInRange(position, 19, (UnitFaction)faction, &units);
+	}
+	for (std::vector<BattleUnit*>::iterator i = units.begin(); i != units.end(); ++i)
 	{
-		if (distance(position, (*i)->getPosition()) < 20 && (*i)->getFaction() == _save->getSide())
+		if (distance(position, (*i)->getPosition()) < 20)
 		{
-			calculateFOV(*i);
+			// the terrain in view of this unit changed
+			(*i)->setFovCached(false);
+			if ((*i)->getFaction() == _save->getSide())
+			{
+				calculateFOV(*i);
+			}
 		}
 	}
 }
@@ -408,6 +673,7 @@ void TileEngine::calculateFOV(const Position &position)
  */
 bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, BattleUnit *potentialVictim, bool recalculateFOV)
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	double highestReactionScore = 0;
 	action->actor = 0;
 
@@ -417,7 +683,7 @@ bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, Battl
 		return false;
 	}
 
-	if (potentialVictim && RNG::generate(0, 4) == 1 && potentialVictim->getFaction() == FACTION_HOSTILE)
+	if (potentialVictim && RNG::generate(RNG::STREAM_COMBAT, 0, 4) == 1 && potentialVictim->getFaction() == FACTION_HOSTILE)
 	{
 		potentialVictim->lookAt(unit->getPosition());
 		while (potentialVictim->getStatus() == STATUS_TURNING)
@@ -442,7 +708,16 @@ bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, Battl
 	// we reset the unit to false here - if it is seen by any unit in range below the unit becomes visible again
 	unit->setVisible(false);
 
-	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	// distance() rounds, so units closer than 19 tiles are at most 18 tiles away along each axis
+	std::vector<BattleUnit*> spotters;
+	for (int faction = FACTION_PLAYER; faction <= FACTION_NEUTRAL; ++faction)
+	{
+		if (faction != _save->getSide())
+		{
+			_save->getUnitsInRange(unit->getPosition(), 18, (UnitFaction)faction, &spotters);
+		}
+	}
+	for (std::vector<BattleUnit*>::iterator i = spotters.begin(); i != spotters.end(); ++i)
 	{
 		if (distance(unit->getPosition(), (*i)->getPosition()) < 19 && (*i)->getFaction() != _save->getSide() && !(*i)->isOut())
 		{
@@ -504,6 +779,7 @@ bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, Battl
  */
 void TileEngine::explode(const Position &center, int power, ItemDamageType type, int maxRadius, BattleUnit *unit)
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	if (type == DT_AP || type == DT_PLASMA || type == DT_LASER)
 	{
 		Tile *tile = _save->getTile(Position(center.x/16, center.y/16, center.z/24));
@@ -511,13 +787,16 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 		if (part >= 0 && part <= 3)
 		{
 			// power 25% to 75%
-			int rndPower = RNG::generate(power/4, (power*3)/4); //RNG::boxMuller(power, power/6)
-			tile->damage(part, rndPower);
+			int rndPower = RNG::generate(RNG::STREAM_COMBAT, power/4, (power*3)/4); //RNG::boxMuller(RNG::STREAM_COMBAT, power, power/6)
+			if (tile->damage(part, rndPower))
+			{
+				updateTerrainVoxels(tile);
+			}
 		}
 		else if (part == 4)
 		{
 			// power 0 - 200%
-			int rndPower = RNG::generate(0, power*2); // RNG::boxMuller(power, power/3)
+			int rndPower = RNG::generate(RNG::STREAM_COMBAT, 0, power*2); // RNG::boxMuller(RNG::STREAM_COMBAT, power, power/3)
 			BattleUnit *bu = tile->getUnit();
 			if (bu)
 			{
@@ -540,7 +819,7 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 			// conventional weapons can cause additional stun damage
 			if (type == DT_AP && bu)
 			{
-				bu->damage(Position(center.x%16, center.y%16, center.z%24), RNG::generate(0, rndPower/4), DT_STUN);
+				bu->damage(Position(center.x%16, center.y%16, center.z%24), RNG::generate(RNG::STREAM_COMBAT, 0, rndPower/4), DT_STUN);
 			}
 
 			unit->addFiringExp();
@@ -606,7 +885,7 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 						{
 							// power 50 - 150%
 							if (dest->getUnit())
-								dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5)), type);
+								dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(RNG::STREAM_COMBAT, power_/2.0, power_*1.5)), type);
 							// destroy floors above
 							/*Tile *tileAbove = _save->getTile(Position(tileX, tileY, tileZ+1));
 							if ( tileAbove && tileAbove->getMapData(MapData::O_FLOOR) && power_ / 2 >= tileAbove->getMapData(MapData::O_FLOOR)->getArmor())
@@ -619,7 +898,7 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 							// smoke from explosions always stay 6 to 14 turns - power of a smoke grenade is 60
 							if (dest->getSmoke() < 10)
 							{
-								dest->addSmoke(RNG::generate(power_/10, 14));
+								dest->addSmoke(RNG::generate(RNG::STREAM_COMBAT, power_/10, 14));
 							}
 						}
 						if (type == DT_IN && !dest->isVoid())
@@ -630,8 +909,8 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 							}
 							if (dest->getUnit())
 							{
-								dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(0, power_/3), type); // immediate IN damage
-								dest->getUnit()->setFire(RNG::generate(1, 5)); // catch fire and burn for 1-5 rounds
+								dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(RNG::STREAM_COMBAT, 0, power_/3), type); // immediate IN damage
+								dest->getUnit()->setFire(RNG::generate(RNG::STREAM_COMBAT, 1, 5)); // catch fire and burn for 1-5 rounds
 							}
 						}
 					}
@@ -648,13 +927,17 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 			for (std::set<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
 			{
 				(*i)->detonate();
+				updateTerrainVoxels(*i);
 			}
 		}
 	}
 
-	calculateSunShading(); // roofs could have been destroyed
-	calculateFOV(center);
+	Position centerTile = Position(center.x/16, center.y/16, center.z/24);
+	// roofs could have been destroyed, explosive power drops by 10 per tile
+	calculateSunShading(centerTile, std::min(maxRadius, power / 10) + 1);
+	calculateFOV(centerTile);
 	calculateTerrainLighting(); // fires could have been started
+	_save->getPathfinding()->invalidateReachable();
 }
 
 /**
@@ -939,7 +1222,17 @@ int TileEngine::unitOpensDoor(BattleUnit *unit)
 
 	if (door == 0 || door == 1)
 	{
+		// adjacent ufo door parts are opened up to 2 tiles away
+		for (int x = -2; x < size + 2; x++)
+		{
+			for (int y = -2; y < size + 2; y++)
+			{
+				Tile *tile = _save->getTile(unit->getPosition() + Position(x,y,0));
+				if (tile) updateTerrainVoxels(tile);
+			}
+		}
 		calculateFOV(unit->getPosition());
+		_save->getPathfinding()->invalidateReachable();
 	}
 
 	return door;
@@ -956,11 +1249,133 @@ int TileEngine::closeUfoDoors()
 	// prepare a list of tiles on fire/smoke & close any ufo doors
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
-		doorsclosed += _save->getTiles()[i]->closeUfoDoor();
+		if (_save->getTiles()[i]->closeUfoDoor())
+		{
+			updateTerrainVoxels(_save->getTiles()[i]);
+			doorsclosed++;
+		}
+	}
+	if (doorsclosed > 0)
+	{
+		_save->getPathfinding()->invalidateReachable();
 	}
 
 	return doorsclosed;
 }
+/**
+ * Traces a batch of rays from the same origin voxel using the bresenham algorithm in 3D.
+ * The rays are stepped together one voxel at a time, so the tracing stops as soon as the
+ * first ray in the batch that reaches the target is known. The smoke along each ray is
+ * summed up while stepping.
+ * @param origin The voxel all rays start from.
+ * @param rays The rays to trace, in order of preference; their results are filled in.
+ * @param count Number of rays, at most MAX_VISIBILITY_RAYS.
+ * @param excludeUnit Excludes this unit in the collision detection.
+ * @param targetTile A ray reaches the target when it hits nothing, or a unit on this tile.
+ * @return Index of the first ray reaching the target, -1 if none does.
+ */
+int TileEngine::traceRays(const Position& origin, VoxelRay *rays, int count, BattleUnit *excludeUnit, Tile *targetTile)
+{
+	int x[MAX_VISIBILITY_RAYS], end_x[MAX_VISIBILITY_RAYS], y[MAX_VISIBILITY_RAYS], z[MAX_VISIBILITY_RAYS];
+	int delta_x[MAX_VISIBILITY_RAYS], delta_y[MAX_VISIBILITY_RAYS], delta_z[MAX_VISIBILITY_RAYS];
+	int step_x[MAX_VISIBILITY_RAYS], step_y[MAX_VISIBILITY_RAYS], step_z[MAX_VISIBILITY_RAYS];
+	int drift_xy[MAX_VISIBILITY_RAYS], drift_xz[MAX_VISIBILITY_RAYS];
+	bool swap_xy[MAX_VISIBILITY_RAYS], swap_xz[MAX_VISIBILITY_RAYS], done[MAX_VISIBILITY_RAYS];
+	int targetIndex = _save->getTileIndex(targetTile->getPosition());
+	int originIndex = _save->getTileIndex(Position(origin.x/16, origin.y/16, origin.z/24));
+	int originSmoke = _save->getTiles()[originIndex]->getSmoke() / 2;
+	count = std::min(count, (int)MAX_VISIBILITY_RAYS);
+	int active = count;
+	for (int i = 0; i < count; ++i)
+	{
+		int x0 = origin.x, y0 = origin.y, z0 = origin.z;
+		int x1 = rays[i].target.x, y1 = rays[i].target.y, z1 = rays[i].target.z;
+		//'steep' xy Line, make longest delta x plane
+		swap_xy[i] = abs(y1 - y0) > abs(x1 - x0);
+		if (swap_xy[i])
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		//do same for xz
+		swap_xz[i] = abs(z1 - z0) > abs(x1 - x0);
+		if (swap_xz[i])
+		{
+			std::swap(x0, z0);
+			std::swap(x1, z1);
+		}
+		delta_x[i] = abs(x1 - x0);
+		delta_y[i] = abs(y1 - y0);
+		delta_z[i] = abs(z1 - z0);
+		drift_xy[i] = delta_x[i] / 2;
+		drift_xz[i] = delta_x[i] / 2;
+		step_x[i] = x0 > x1 ? -1 : 1;
+		step_y[i] = y0 > y1 ? -1 : 1;
+		step_z[i] = z0 > z1 ? -1 : 1;
+		x[i] = x0; y[i] = y0; z[i] = z0;
+		end_x[i] = x1;
+		done[i] = false;
+		rays[i].result = -1;
+		rays[i].lastTile = originIndex;
+		rays[i].smoke = originSmoke;
+	}
+
+	while (active > 0)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (done[i])
+				continue;
+			//unswap (in reverse)
+			int cx = x[i], cy = y[i], cz = z[i];
+			if (swap_xz[i]) std::swap(cx, cz);
+			if (swap_xy[i]) std::swap(cx, cy);
+
+			int result = voxelCheck(Position(cx, cy, cz), excludeUnit);
+			if (result != 5)
+			{
+				int index = _save->getTileIndex(Position(cx/16, cy/16, cz/24));
+				if (index != rays[i].lastTile)
+				{
+					rays[i].lastTile = index;
+					rays[i].smoke += _save->getTiles()[index]->getSmoke() / 2;
+				}
+			}
+			if (result != -1 || x[i] == end_x[i])
+			{
+				rays[i].result = result;
+				done[i] = true;
+				active--;
+				continue;
+			}
+			//update progress in other planes
+			x[i] += step_x[i];
+			drift_xy[i] -= delta_y[i];
+			drift_xz[i] -= delta_z[i];
+			if (drift_xy[i] < 0)
+			{
+				y[i] += step_y[i];
+				drift_xy[i] += delta_x[i];
+			}
+			if (drift_xz[i] < 0)
+			{
+				z[i] += step_z[i];
+				drift_xz[i] += delta_x[i];
+			}
+		}
+
+		// the first ray that is not blocked decides, as soon as all rays before it are blocked
+		for (int i = 0; i < count; ++i)
+		{
+			if (!done[i])
+				break;
+			if (rays[i].result == -1 || (rays[i].result == 4 && rays[i].lastTile == targetIndex))
+				return i;
+		}
+	}
+	return -1;
+}
+
 /**
  * calculateLine. Using bresenham algorithm in 3D.
  * @param origin
@@ -973,6 +1388,7 @@ int TileEngine::closeUfoDoors()
  */
 int TileEngine::calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck)
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	int x, x0, x1, delta_x, step_x;
 	int y, y0, y1, delta_y, step_y;
 	int z, z0, z1, delta_z, step_z;
@@ -1099,6 +1515,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
  */
 int TileEngine::calculateParabola(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, double curvature, double accuracy)
 {
+	Profiler::Scope scope(Profiler::ZONE_TILEENGINE);
 	double ro = sqrt((double)((target.x - origin.x) * (target.x - origin.x) + (target.y - origin.y) * (target.y - origin.y) + (target.z - origin.z) * (target.z - origin.z)));
 
 	double fi = acos((double)(target.z - origin.z) / ro);
@@ -1140,6 +1557,8 @@ int TileEngine::calculateParabola(const Position& origin, const Position& target
 
 /**
  * Check if we hit a voxel.
+ * Terrain is tested against the precomputed voxel occupancy first, the objects themselves are
+ * only looked at to find out which one was hit.
  * @param voxel The voxel to check.
  * @param excludeUnit Don't do checks on this unit.
  * @param excludeAllUnits Don't do checks on any unit.
@@ -1147,43 +1566,44 @@ int TileEngine::calculateParabola(const Position& origin, const Position& target
  */
 int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits)
 {
-
-	Tile *tile = _save->getTile(Position(voxel.x/16, voxel.y/16, voxel.z/24));
 	// check if we are not out of the map
-	if (tile == 0 || voxel.x < 0 || voxel.y < 0 || voxel.z < 0)
+	if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0
+		|| voxel.x >= _save->getWidth() * 16 || voxel.y >= _save->getLength() * 16 || voxel.z >= _save->getHeight() * 24)
 	{
 		return 5;
 	}
 
+	int tileIndex = _save->getTileIndex(Position(voxel.x/16, voxel.y/16, voxel.z/24));
+	Tile *tile = _save->getTiles()[tileIndex];
+	int x = voxel.x%16;
+	int y = voxel.y%16;
+	int z = voxel.z%24;
+
 	if (!excludeAllUnits)
 	{
 		BattleUnit *unit = tile->getUnit();
 		if (unit != 0 && unit != excludeUnit)
 		{
-			if ((voxel.z%24) < (unit->getHeight()+(-tile->getTerrainLevel())) && (voxel.z%24) > (1+(-tile->getTerrainLevel())))
+			if (z < (unit->getHeight()+(-tile->getTerrainLevel())) && z > (1+(-tile->getTerrainLevel())))
 			{
-				int x = voxel.x%16;
-				int y = voxel.y%16;
 				int idx = (unit->getUnit()->getLoftemps() * 16) + y;
-				if ((_voxelData->at(idx) & (1 << x))==(1 << x))
+				if ((*_voxelData)[idx] & (1 << x))
 				{
 					return 4;
 				}
 			}
 		}
 		// sometimes there is unit on the tile below, but sticks up to this tile with his head
-		Tile *below = _save->getTile(Position(voxel.x/16, voxel.y/16, (voxel.z/24)-1));
-		if (below)
+		if (voxel.z >= 24)
 		{
-			BattleUnit *unit = below->getUnit();
+			Tile *below = _save->getTiles()[tileIndex - _save->getWidth() * _save->getLength()];
+			unit = below->getUnit();
 			if (unit != 0 && unit != excludeUnit)
 			{
-				if ((voxel.z%24) < ((unit->getHeight()+(-below->getTerrainLevel()))-24))
+				if (z < ((unit->getHeight()+(-below->getTerrainLevel()))-24))
 				{
-					int x = voxel.x%16;
-					int y = voxel.y%16;
 					int idx = (unit->getUnit()->getLoftemps() * 16) + y;
-					if ((_voxelData->at(idx) & (1 << x))==(1 << x))
+					if ((*_voxelData)[idx] & (1 << x))
 					{
 						return 4;
 					}
@@ -1192,6 +1612,15 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 		}
 	}
 
+	if (_terrainVoxels.empty())
+	{
+		calculateTerrainVoxels();
+	}
+	if (!(_terrainVoxels[tileIndex * VOXEL_ROWS_PER_TILE + (z/2) * 16 + y] & (1 << (15 - x))))
+	{
+		return -1;
+	}
+
 	for (int i=0; i< 4; ++i)
 	{
 		MapData *mp = tile->getMapData(i);
@@ -1199,10 +1628,8 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 			continue;
 		if (mp != 0)
 		{
-			int x = 15 - voxel.x%16;
-			int y = voxel.y%16;
-			int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
-			if ((_voxelData->at(idx) & (1 << x))==(1 << x))
+			int idx = (mp->getLoftID(z/2)*16) + y;
+			if ((*_voxelData)[idx] & (1 << (15 - x)))
 			{
 				return i;
 			}
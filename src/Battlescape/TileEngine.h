@@ -33,6 +33,39 @@ class BattleUnit;
 class BattleItem;
 class Tile;
 
+/**
+ * A point light on the battlescape: a lamp, a fire, a flare or a soldier's personal light.
+ */
+struct LightSource
+{
+	Position position;
+	int power;
+	/// Creates a light source.
+	LightSource(const Position &position_, int power_) : position(position_), power(power_) {};
+	/// Orders light sources by position and power.
+	bool operator<(const LightSource &other) const
+	{
+		if (position.z != other.position.z) return position.z < other.position.z;
+		if (position.y != other.position.y) return position.y < other.position.y;
+		if (position.x != other.position.x) return position.x < other.position.x;
+		return power < other.power;
+	}
+};
+
+/**
+ * A ray between two voxels, traced in a batch with other rays from the same origin.
+ */
+struct VoxelRay
+{
+	Position target;
+	/// What the ray hit: objectnumber(0-3), unit(4), out of map(5) or -1(hit nothing).
+	int result;
+	/// Index of the tile the ray ended in.
+	int lastTile;
+	/// Smoke density of the tiles the ray passed through, halved.
+	int smoke;
+};
+
 /**
  * A utility class that modifies tile properties on a battlescape map. This includes lighting, destruction, smoke, fire, fog of war.
  * Note that this function does not handle any sounds or animations.
@@ -42,9 +75,25 @@ class TileEngine
 private:
 	static const int MAX_VIEW_DISTANCE = 20;
 	static const int MAX_DARKNESS_TO_SEE_UNITS = 9;
+	static const int VIEW_FAN_SIZE = MAX_VIEW_DISTANCE * 2 + 1;
+	static const int VOXEL_ROWS_PER_TILE = 12 * 16;
+	static const int MAX_VISIBILITY_RAYS = 16;
 	SavedBattleGame *_save;
 	std::vector<Uint16> *_voxelData;
+	std::vector<int> _viewFanParent;
+	std::vector<int> _viewCone[8];
+	std::vector<bool> _viewConeMask[8];
+	std::vector<char> _viewFanVisible;
+	void initViewFan();
+	int viewFanIndex(int x, int y, int z) const;
+	Position viewFanOffset(int index) const;
+	std::vector<LightSource> _lightSources[3];
+	std::vector<bool> _dirtyColumns;
+	std::vector<int> _roofLevel;
+	std::vector<Uint16> _terrainVoxels;
 	void addLight(const Position &center, int power, int layer);
+	void updateLightSources(std::vector<LightSource> &sources, int layer);
+	void updateRoofLevel(int x, int y);
 	int blockage(Tile *tile, const int part, ItemDamageType type);
 	int vectorToDirection(const Position &vector);
 	int voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits = false);
@@ -56,8 +105,14 @@ public:
 	~TileEngine();
 	/// Calculate sun shading of the whole map.
 	void calculateSunShading();
+	/// Calculate sun shading of the columns within range of a certain position.
+	void calculateSunShading(const Position &position, int radius);
 	/// Calculate sun shading of a single tile.
 	void calculateSunShading(Tile *tile);
+	/// Calculate the voxel occupancy of the terrain of the whole map.
+	void calculateTerrainVoxels();
+	/// Update the voxel occupancy of a single tile.
+	void updateTerrainVoxels(Tile *tile);
 	/// Calculate the field of view from a units view point.
 	bool calculateFOV(BattleUnit *unit);
 	/// Calculate the field of view within range of a certain position.
@@ -78,6 +133,8 @@ public:
 	int closeUfoDoors();
 	/// Calculate line.
 	int calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck = true);
+	/// Trace a batch of rays from the same origin.
+	int traceRays(const Position& origin, VoxelRay *rays, int count, BattleUnit *excludeUnit, Tile *targetTile);
 	/// Calculate a parabola trajectory.
 	int calculateParabola(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, double curvature, double accuracy);
 	bool visible(BattleUnit *currentUnit, Tile *tile);
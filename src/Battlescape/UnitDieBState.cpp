@@ -20,6 +20,7 @@
 #include "UnitDieBState.h"
 #include "ExplosionBState.h"
 #include "TileEngine.h"
+#include "Pathfinding.h"
 #include "BattlescapeState.h"
 #include "Map.h"
 #include "Camera.h"
@@ -168,6 +169,7 @@ void UnitDieBState::convertUnitToCorpse()
 
 	// remove unit-tile link
 	_unit->setTile(0);
+	_parent->getSave()->getPathfinding()->invalidateReachable();
 
 	if (size == 0)
 	{
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "UnitSpriteCache.h"
+#include <cstring>
+#include "UnitSprite.h"
+#include "../Engine/Surface.h"
+#include "../Engine/SurfaceSet.h"
+#include "../Ruleset/RuleArmor.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/BattleItem.h"
+#include "../Savegame/Soldier.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Orders sprite keys by their contents.
+ * @param other Key to compare with.
+ * @return True if this key goes first.
+ */
+bool UnitSpriteKey::operator<(const UnitSpriteKey &other) const
+{
+	return memcmp(this, &other, sizeof(UnitSpriteKey)) < 0;
+}
+
+/**
+ * Sets up an empty cache.
+ * @param width Width in pixels of each sprite.
+ * @param height Height in pixels of each sprite.
+ * @param itemSprites Pointer to the surface set of items held in hand.
+ */
+UnitSpriteCache::UnitSpriteCache(int width, int height, SurfaceSet *itemSprites) : _sprites(), _keys(), _itemSprites(itemSprites), _width(width), _height(height), _lastUse(0), _hits(0), _misses(0)
+{
+	_renderer = new UnitSprite(width, height, 0, 0);
+}
+
+/**
+ * Deletes all the sprites in the cache.
+ */
+UnitSpriteCache::~UnitSpriteCache()
+{
+	for (std::map<UnitSpriteKey, Entry>::iterator i = _sprites.begin(); i != _sprites.end(); ++i)
+	{
+		delete i->second.surface;
+	}
+	delete _renderer;
+}
+
+/**
+ * Returns the sprite of a part of a unit as it looks right now,
+ * drawing it only if no unit has looked like that recently.
+ * The sprite is kept until it's released again.
+ * @param unit Pointer to the unit.
+ * @param item Pointer to the item in the unit's hand, if any.
+ * @param sprites Pointer to the surface set of the unit's armor.
+ * @param part Part of the unit (0 for small units, 0-3 for large units).
+ * @param frame Current animation frame of the map.
+ * @return Pointer to the sprite.
+ */
+Surface *UnitSpriteCache::getSprite(BattleUnit *unit, BattleItem *item, SurfaceSet *sprites, int part, int frame)
+{
+	UnitSpriteKey key;
+	memset(&key, 0, sizeof(key));
+	key.sprites = sprites;
+	key.routine = unit->getUnit()->getArmor()->getDrawingRoutine();
+	key.part = part;
+	key.out = unit->isOut();
+	if (!key.out)
+	{
+		// only walking, falling and aiming change how a unit is drawn
+		UnitStatus status = unit->getStatus();
+		if (status == STATUS_WALKING)
+		{
+			key.status = status;
+			key.phase = unit->getWalkingPhase();
+		}
+		else if (status == STATUS_FALLING)
+		{
+			key.status = status;
+			key.phase = unit->getFallingPhase();
+		}
+		else if (status == STATUS_AIMING)
+		{
+			key.status = status;
+		}
+		else
+		{
+			key.status = STATUS_STANDING;
+		}
+		key.direction = unit->getDirection();
+		key.turret = unit->getTurretType();
+		key.turretDirection = unit->getTurretDirection();
+		Soldier *soldier = dynamic_cast<Soldier*>(unit->getUnit());
+		key.female = (soldier != 0 && soldier->getGender() == GENDER_FEMALE);
+		key.kneeled = unit->isKneeled();
+		key.flying = (unit->getUnit()->getArmor()->getMovementType() == MT_FLY);
+		key.standHeight = unit->getUnit()->getStandHeight();
+		key.item = -1;
+		if (item != 0)
+		{
+			key.item = item->getRules()->getHandSprite();
+			key.twoHanded = item->getRules()->getTwoHanded();
+		}
+		// only the propulsion of large units is animated
+		if (part > 0)
+		{
+			key.frame = frame;
+		}
+	}
+
+	std::map<UnitSpriteKey, Entry>::iterator i = _sprites.find(key);
+	if (i != _sprites.end())
+	{
+		_hits++;
+	}
+	else
+	{
+		_misses++;
+		evict();
+		Entry entry;
+		entry.surface = new Surface(_width, _height);
+		entry.surface->setPalette(_renderer->getPalette());
+		entry.users = 0;
+		_renderer->setBattleUnit(unit, part);
+		_renderer->setBattleItem(item);
+		_renderer->setSurfaces(sprites, _itemSprites);
+		_renderer->setAnimationFrame(frame);
+		_renderer->blit(entry.surface);
+		i = _sprites.insert(std::make_pair(key, entry)).first;
+		_keys[entry.surface] = key;
+	}
+	i->second.users++;
+	i->second.lastUse = ++_lastUse;
+	return i->second.surface;
+}
+
+/**
+ * Lets go of a sprite when a unit stops looking like it,
+ * so it can be dropped once no other unit uses it either.
+ * @param sprite Pointer to the sprite (can be null).
+ */
+void UnitSpriteCache::release(Surface *sprite)
+{
+	std::map<Surface*, UnitSpriteKey>::iterator i = _keys.find(sprite);
+	if (i != _keys.end())
+	{
+		Entry &entry = _sprites[i->second];
+		if (entry.users > 0)
+		{
+			entry.users--;
+		}
+	}
+}
+
+/**
+ * Drops the least recently used sprites nobody is using
+ * while the cache is full. Sprites in use are never dropped,
+ * so the cache can go over budget if every sprite is in use.
+ */
+void UnitSpriteCache::evict()
+{
+	while (_sprites.size() >= MAX_SPRITES)
+	{
+		std::map<UnitSpriteKey, Entry>::iterator oldest = _sprites.end();
+		for (std::map<UnitSpriteKey, Entry>::iterator i = _sprites.begin(); i != _sprites.end(); ++i)
+		{
+			if (i->second.users == 0 && (oldest == _sprites.end() || i->second.lastUse < oldest->second.lastUse))
+			{
+				oldest = i;
+			}
+		}
+		if (oldest == _sprites.end())
+		{
+			return;
+		}
+		_keys.erase(oldest->second.surface);
+		delete oldest->second.surface;
+		_sprites.erase(oldest);
+	}
+}
+
+/**
+ * Replaces a certain amount of colors in the palette of all the sprites.
+ * @param colors Pointer to the set of colors.
+ * @param firstcolor Offset of the first color to replace.
+ * @param ncolors Amount of colors to replace.
+ */
+void UnitSpriteCache::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
+{
+	_renderer->setPalette(colors, firstcolor, ncolors);
+	for (std::map<UnitSpriteKey, Entry>::iterator i = _sprites.begin(); i != _sprites.end(); ++i)
+	{
+		i->second.surface->setPalette(colors, firstcolor, ncolors);
+	}
+}
+
+/**
+ * Returns how many times a sprite was already in the cache.
+ * @return Number of hits.
+ */
+int UnitSpriteCache::getHits() const
+{
+	return _hits;
+}
+
+/**
+ * Returns how many times a sprite had to be drawn.
+ * @return Number of misses.
+ */
+int UnitSpriteCache::getMisses() const
+{
+	return _misses;
+}
+
+/**
+ * Returns how many sprites are in the cache.
+ * @return Number of sprites.
+ */
+int UnitSpriteCache::getSize() const
+{
+	return _sprites.size();
+}
+
+}
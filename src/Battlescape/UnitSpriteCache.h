@@ -0,0 +1,97 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_UNITSPRITECACHE_H
+#define OPENXCOM_UNITSPRITECACHE_H
+
+#include <map>
+#include "SDL.h"
+
+namespace OpenXcom
+{
+
+class Surface;
+class SurfaceSet;
+class UnitSprite;
+class BattleUnit;
+class BattleItem;
+
+/**
+ * Everything that decides how a part of a unit looks,
+ * so units that look the same can share their sprites.
+ * @note Compared byte by byte, so it's always cleared before
+ * being filled in, padding included.
+ */
+struct UnitSpriteKey
+{
+	SurfaceSet *sprites;
+	int routine, part, out, status, phase, direction, turret, turretDirection;
+	int female, kneeled, flying, standHeight, item, twoHanded, frame;
+	/// Orders keys for lookup.
+	bool operator<(const UnitSpriteKey &other) const;
+};
+
+/**
+ * Cache of rendered unit sprites shared by all the units on the map.
+ * Each sprite is drawn once for every look a unit can have and kept
+ * while any unit uses it, so identical soldiers, aliens and civilians
+ * don't each keep their own copies. Sprites nobody uses any more are
+ * dropped, least recently used first, once the cache is full.
+ */
+class UnitSpriteCache
+{
+private:
+	static const unsigned int MAX_SPRITES = 1024;
+	struct Entry
+	{
+		Surface *surface;
+		int users;
+		unsigned int lastUse;
+	};
+	std::map<UnitSpriteKey, Entry> _sprites;
+	std::map<Surface*, UnitSpriteKey> _keys;
+	UnitSprite *_renderer;
+	SurfaceSet *_itemSprites;
+	int _width, _height;
+	unsigned int _lastUse;
+	int _hits, _misses;
+
+	/// Drops unused sprites until the cache fits its budget.
+	void evict();
+public:
+	/// Creates a cache of unit sprites of a certain size.
+	UnitSpriteCache(int width, int height, SurfaceSet *itemSprites);
+	/// Cleans up the cache.
+	~UnitSpriteCache();
+	/// Gets the sprite of a part of a unit.
+	Surface *getSprite(BattleUnit *unit, BattleItem *item, SurfaceSet *sprites, int part, int frame);
+	/// Lets go of a sprite returned by getSprite.
+	void release(Surface *sprite);
+	/// Sets the palette of the sprites.
+	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256);
+	/// Gets how many sprites were found in the cache.
+	int getHits() const;
+	/// Gets how many sprites had to be drawn.
+	int getMisses() const;
+	/// Gets how many sprites are in the cache.
+	int getSize() const;
+};
+
+}
+
+#endif
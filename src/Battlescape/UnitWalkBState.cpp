@@ -137,6 +137,8 @@ void UnitWalkBState::think()
 					_parent->getSave()->getTile(_unit->getPosition() + Position(x,y,0))->setUnit(_unit);
 				}
 			}
+			_parent->getSave()->updateUnitGrid(_unit);
+			_parent->getSave()->getPathfinding()->invalidateReachable();
 
 			// if the unit changed level, camera changes level with
 			_parent->getMap()->getCamera()->setViewHeight(_unit->getPosition().z);
@@ -0,0 +1,503 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "AssetCache.h"
+#include <map>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include "CrossPlatform.h"
+
+namespace OpenXcom
+{
+namespace AssetCache
+{
+
+/// Cache file format version, bump when the layout changes.
+const Uint32 VERSION = 1;
+/// Size of the file header: magic, version, entry count, directory checksum.
+const size_t HEADER_SIZE = 16;
+
+/**
+ * Decoded contents of a file or a set of files.
+ */
+struct CacheEntry
+{
+	/// Modification time and size of the files the entry came from.
+	Uint32 source[4];
+	/// Frame size and layout, all zero for plain files.
+	Uint32 width, height, pitch, frames;
+	/// Where the contents are, in the mapping or in data.
+	Uint8 *contents;
+	Uint32 length, checksum;
+	bool verified;
+	/// Contents decoded during this run.
+	std::vector<Uint8> data;
+};
+
+std::string _filename;
+std::map<std::string, CacheEntry> _entries;
+Uint8 *_mapping = 0;
+size_t _mappingSize = 0;
+SDL_mutex *_mutex = 0;
+bool _changed = false;
+
+/**
+ * Locks the cache against the loader threads. Without an
+ * open cache there are no threads using it to worry about.
+ */
+static void lock()
+{
+	if (_mutex != 0)
+		SDL_LockMutex(_mutex);
+}
+
+/**
+ * Unlocks the cache for the loader threads.
+ */
+static void unlock()
+{
+	if (_mutex != 0)
+		SDL_UnlockMutex(_mutex);
+}
+
+/**
+ * Calculates the FNV-1a checksum of a block of memory.
+ * @param data Pointer to the data.
+ * @param length Size in bytes.
+ * @return Checksum.
+ */
+static Uint32 checksum(const Uint8 *data, size_t length)
+{
+	Uint32 hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Reads a little-endian 32-bit number.
+ * @param data Pointer to the number, advanced past it.
+ * @return Number.
+ */
+static Uint32 readInt(const Uint8 *&data)
+{
+	Uint32 value = data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32)data[3] << 24);
+	data += 4;
+	return value;
+}
+
+/**
+ * Appends a little-endian 32-bit number.
+ * @param out Buffer to write to.
+ * @param value Number.
+ */
+static void writeInt(std::vector<Uint8> &out, Uint32 value)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		out.push_back((value >> (i * 8)) & 0xFF);
+	}
+}
+
+/**
+ * Gets the modification time and size of a file
+ * as they're stored in a cache entry.
+ * @param path Full path to file.
+ * @param source Pointer to store the two numbers.
+ */
+static void getSource(const std::string &path, Uint32 *source)
+{
+	time_t modified = 0;
+	long size = 0;
+	if (!CrossPlatform::getFileInfo(path, &modified, &size))
+	{
+		modified = 0;
+		size = -1;
+	}
+	source[0] = (Uint32)modified;
+	source[1] = (Uint32)size;
+}
+
+/**
+ * Looks up a cache entry that's still valid for
+ * its source files. The contents of an entry from the
+ * mapping are checked against its checksum the first
+ * time it's used, and stale or damaged entries are dropped.
+ * Must be called with the mutex locked.
+ * @param name Entry name.
+ * @param source Current modification times and sizes of the source files.
+ * @return Pointer to the entry, or 0 if there's none.
+ */
+static CacheEntry *find(const std::string &name, const Uint32 *source)
+{
+	std::map<std::string, CacheEntry>::iterator i = _entries.find(name);
+	if (i == _entries.end())
+	{
+		return 0;
+	}
+	CacheEntry *entry = &i->second;
+	if (memcmp(entry->source, source, sizeof(entry->source)) != 0 ||
+		(!entry->verified && checksum(entry->contents, entry->length) != entry->checksum))
+	{
+		_entries.erase(i);
+		_changed = true;
+		return 0;
+	}
+	entry->verified = true;
+	return entry;
+}
+
+/**
+ * Reads the directory of the mapped cache file.
+ * @return True if the whole file is valid.
+ */
+static bool readDirectory()
+{
+	if (_mappingSize < HEADER_SIZE || memcmp(_mapping, "OXAC", 4) != 0)
+	{
+		return false;
+	}
+	const Uint8 *p = _mapping + 4;
+	if (readInt(p) != VERSION)
+	{
+		return false;
+	}
+	Uint32 count = readInt(p);
+	Uint32 dirChecksum = readInt(p);
+	const Uint8 *end = _mapping + _mappingSize;
+	const Uint8 *dir = p;
+	for (Uint32 i = 0; i < count; ++i)
+	{
+		if (end - p < 4)
+			return false;
+		Uint32 nameLength = readInt(p);
+		if ((Uint32)(end - p) < 44 || (Uint32)(end - p) - 44 < nameLength)
+			return false;
+		std::string name((const char*)p, nameLength);
+		p += nameLength;
+		CacheEntry &entry = _entries[name];
+		for (int j = 0; j < 4; ++j)
+		{
+			entry.source[j] = readInt(p);
+		}
+		entry.width = readInt(p);
+		entry.height = readInt(p);
+		entry.pitch = readInt(p);
+		entry.frames = readInt(p);
+		Uint32 offset = readInt(p);
+		entry.length = readInt(p);
+		entry.checksum = readInt(p);
+		entry.verified = false;
+		if (offset > _mappingSize || entry.length > _mappingSize - offset ||
+			(entry.frames != 0 && entry.length != entry.pitch * entry.height * entry.frames))
+		{
+			return false;
+		}
+		entry.contents = _mapping + offset;
+	}
+	return checksum(dir, p - dir) == dirChecksum;
+}
+
+/**
+ * Maps a cache file into memory and reads its directory.
+ * A missing or invalid file just leaves the cache empty,
+ * to be filled as things are decoded.
+ * @param filename Full path to the cache file.
+ */
+void open(const std::string &filename)
+{
+	close();
+	_filename = filename;
+	_mutex = SDL_CreateMutex();
+
+	// A cache that couldn't replace the mapped one last time
+	std::string pending = _filename + ".new";
+	time_t modified;
+	long size;
+	if (CrossPlatform::getFileInfo(pending, &modified, &size))
+	{
+		CrossPlatform::moveFile(pending, _filename);
+	}
+
+	_mapping = (Uint8*)CrossPlatform::mapFile(_filename, &_mappingSize);
+	if (_mapping != 0 && !readDirectory())
+	{
+		_entries.clear();
+		CrossPlatform::unmapFile(_mapping, _mappingSize);
+		_mapping = 0;
+		_mappingSize = 0;
+		_changed = true;
+	}
+}
+
+/**
+ * Writes every valid entry to a new cache file, including
+ * the ones decoded during this run, then puts it in place
+ * of the old one. If the old one can't be replaced while
+ * it's mapped, the new one is left next to it and takes
+ * over the next time the cache is opened.
+ */
+void save()
+{
+	if (_mutex == 0)
+		return;
+	lock();
+	if (!_changed)
+	{
+		unlock();
+		return;
+	}
+
+	// the pixels start after the directory, every entry aligned
+	size_t offset = HEADER_SIZE;
+	for (std::map<std::string, CacheEntry>::iterator i = _entries.begin(); i != _entries.end(); ++i)
+	{
+		offset += 4 + i->first.size() + 44;
+	}
+	offset = (offset + 3) & ~3;
+
+	std::vector<Uint8> dir, payload;
+	for (std::map<std::string, CacheEntry>::iterator i = _entries.begin(); i != _entries.end(); ++i)
+	{
+		while (payload.size() % 4 != 0)
+		{
+			payload.push_back(0);
+		}
+		writeInt(dir, i->first.size());
+		dir.insert(dir.end(), i->first.begin(), i->first.end());
+		for (int j = 0; j < 4; ++j)
+		{
+			writeInt(dir, i->second.source[j]);
+		}
+		writeInt(dir, i->second.width);
+		writeInt(dir, i->second.height);
+		writeInt(dir, i->second.pitch);
+		writeInt(dir, i->second.frames);
+		writeInt(dir, offset + payload.size());
+		writeInt(dir, i->second.length);
+		writeInt(dir, i->second.checksum);
+		payload.insert(payload.end(), i->second.contents, i->second.contents + i->second.length);
+	}
+
+	std::vector<Uint8> header;
+	const char *magic = "OXAC";
+	header.insert(header.end(), magic, magic + 4);
+	writeInt(header, VERSION);
+	writeInt(header, _entries.size());
+	writeInt(header, dir.empty() ? checksum(0, 0) : checksum(&dir[0], dir.size()));
+	while (header.size() + dir.size() < offset)
+	{
+		dir.push_back(0);
+	}
+	_changed = false;
+	unlock();
+
+	std::string tmp = _filename + ".tmp";
+	std::ofstream file(tmp.c_str(), std::ios::out | std::ios::binary);
+	if (!file)
+		return;
+	file.write((const char*)&header[0], header.size());
+	if (!dir.empty())
+		file.write((const char*)&dir[0], dir.size());
+	if (!payload.empty())
+		file.write((const char*)&payload[0], payload.size());
+	file.close();
+	if (!file)
+	{
+		remove(tmp.c_str());
+		return;
+	}
+	if (!CrossPlatform::moveFile(tmp, _filename))
+	{
+		CrossPlatform::moveFile(tmp, _filename + ".new");
+	}
+}
+
+/**
+ * Unmaps the cache file. Any surfaces pointing
+ * into it must have been deleted already.
+ */
+void close()
+{
+	_entries.clear();
+	CrossPlatform::unmapFile(_mapping, _mappingSize);
+	_mapping = 0;
+	_mappingSize = 0;
+	if (_mutex != 0)
+	{
+		SDL_DestroyMutex(_mutex);
+		_mutex = 0;
+	}
+	_changed = false;
+}
+
+/**
+ * Gets the decoded frames of a PCK/TAB image set from the
+ * cache, one after the other, straight from the mapping.
+ * Safe to call from several threads.
+ * @param pck Full path to the PCK image.
+ * @param tab Full path to the TAB offsets.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param pitch Bytes between the start of each row.
+ * @param frames Pointer to store the number of frames.
+ * @return Pointer to the pixels, or 0 if the set isn't in the cache.
+ */
+Uint8 *loadPck(const std::string &pck, const std::string &tab, int width, int height, int pitch, int *frames)
+{
+	if (_mutex == 0)
+		return 0;
+	Uint32 source[4];
+	getSource(pck, source);
+	getSource(tab, source + 2);
+	lock();
+	CacheEntry *entry = find(pck, source);
+	Uint8 *contents = 0;
+	if (entry != 0 && entry->data.empty() && entry->frames != 0 &&
+		entry->width == (Uint32)width && entry->height == (Uint32)height && entry->pitch == (Uint32)pitch)
+	{
+		contents = entry->contents;
+		*frames = entry->frames;
+	}
+	unlock();
+	return contents;
+}
+
+/**
+ * Stores the decoded frames of a PCK/TAB image set in the
+ * cache, to be written out on the next save.
+ * Safe to call from several threads.
+ * @param pck Full path to the PCK image.
+ * @param tab Full path to the TAB offsets.
+ * @param pixels Pointer to the pixels of all the frames, one after the other.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param pitch Bytes between the start of each row.
+ * @param frames Number of frames.
+ */
+void storePck(const std::string &pck, const std::string &tab, const Uint8 *pixels, int width, int height, int pitch, int frames)
+{
+	if (_mutex == 0 || frames == 0)
+		return;
+	CacheEntry entry;
+	getSource(pck, entry.source);
+	getSource(tab, entry.source + 2);
+	entry.width = width;
+	entry.height = height;
+	entry.pitch = pitch;
+	entry.frames = frames;
+	entry.length = pitch * height * frames;
+	entry.data.assign(pixels, pixels + entry.length);
+	entry.checksum = checksum(&entry.data[0], entry.length);
+	entry.verified = true;
+
+	lock();
+	CacheEntry &stored = _entries[pck];
+	stored = entry;
+	stored.contents = &stored.data[0];
+	_changed = true;
+	unlock();
+}
+
+/**
+ * Gets the contents of a data file through the cache,
+ * so records can be parsed straight from memory instead
+ * of being read one by one. Files that aren't in the cache
+ * yet are read whole and added to it. The contents stay
+ * valid until the cache is closed or the file changes,
+ * so they should be parsed right away. Without an open
+ * cache the file is just read into the buffer.
+ * @param filename Full path to the file.
+ * @param size Pointer to store the size in bytes.
+ * @param buffer Pointer to a buffer for the contents if the cache is off.
+ * @return Pointer to the contents, or 0 if the file couldn't be read.
+ */
+const Uint8 *loadFile(const std::string &filename, size_t *size, std::vector<Uint8> *buffer)
+{
+	if (_mutex == 0)
+	{
+		std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+		if (!file)
+		{
+			return 0;
+		}
+		file.seekg(0, std::ios::end);
+		*size = (size_t)file.tellg();
+		file.seekg(0, std::ios::beg);
+		// an empty file still needs somewhere to point to
+		buffer->resize(*size + 1);
+		if (!file.read((char*)&(*buffer)[0], *size))
+		{
+			return 0;
+		}
+		return &(*buffer)[0];
+	}
+	Uint32 source[4] = {0, 0, 0, 0};
+	getSource(filename, source);
+	lock();
+	CacheEntry *entry = find(filename, source);
+	const Uint8 *contents = 0;
+	if (entry != 0 && entry->frames == 0)
+	{
+		*size = entry->length;
+		contents = entry->contents;
+	}
+	unlock();
+	if (contents != 0)
+	{
+		return contents;
+	}
+
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		return 0;
+	}
+	CacheEntry loaded;
+	memcpy(loaded.source, source, sizeof(source));
+	loaded.width = loaded.height = loaded.pitch = loaded.frames = 0;
+	file.seekg(0, std::ios::end);
+	loaded.length = (Uint32)file.tellg();
+	file.seekg(0, std::ios::beg);
+	// an empty file still needs somewhere to point to
+	loaded.data.resize(loaded.length + 1);
+	if (!file.read((char*)&loaded.data[0], loaded.length))
+	{
+		return 0;
+	}
+	loaded.checksum = checksum(&loaded.data[0], loaded.length);
+	loaded.verified = true;
+
+	lock();
+	CacheEntry &stored = _entries[filename];
+	stored = loaded;
+	stored.contents = &stored.data[0];
+	_changed = true;
+	*size = stored.length;
+	contents = stored.contents;
+	unlock();
+	return contents;
+}
+
+}
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_ASSETCACHE_H
+#define OPENXCOM_ASSETCACHE_H
+
+#include <string>
+#include <vector>
+#include "SDL.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Cache of decoded game data, kept in a single file in
+ * the user folder. The first run decodes the original
+ * files as usual and bakes the results into the cache,
+ * later runs map the cache into memory and point straight
+ * into it. Each entry remembers the modification time and
+ * size of the files it came from, so it's rebuilt when they
+ * change, and a checksum so a damaged cache is never used.
+ */
+namespace AssetCache
+{
+	/// Maps the cache file into memory.
+	void open(const std::string &filename);
+	/// Writes out the cache if anything new was decoded.
+	void save();
+	/// Unmaps the cache file.
+	void close();
+	/// Gets the decoded frames of a PCK/TAB set from the cache.
+	Uint8 *loadPck(const std::string &pck, const std::string &tab, int width, int height, int pitch, int *frames);
+	/// Stores the decoded frames of a PCK/TAB set in the cache.
+	void storePck(const std::string &pck, const std::string &tab, const Uint8 *pixels, int width, int height, int pitch, int frames);
+	/// Gets the contents of a data file through the cache.
+	const Uint8 *loadFile(const std::string &filename, size_t *size, std::vector<Uint8> *buffer);
+}
+
+}
+
+#endif
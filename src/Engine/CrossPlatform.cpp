@@ -41,6 +41,9 @@
 #include <stdlib.h>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
 #include <pwd.h>
 #endif
 
@@ -326,5 +329,136 @@ std::vector<std::string> getFolderContents(const std::string &path, const std::s
 	return files;
 }
 
+/**
+ * Gets the last modification time and the size
+ * of a file, to tell if it has changed.
+ * @param path Full path to file.
+ * @param modified Pointer to store the modification time.
+ * @param size Pointer to store the size in bytes.
+ * @return True if the file exists.
+ */
+bool getFileInfo(const std::string &path, time_t *modified, long *size)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+	{
+		return false;
+	}
+	*modified = info.st_mtime;
+	*size = (long)info.st_size;
+	return true;
+}
+
+/**
+ * Moves a file to another path, replacing whatever is
+ * there in one step, so the destination is never left
+ * half-written.
+ * @param src Full path to the file to move.
+ * @param dest Full path to move it to.
+ * @return True if the file was moved.
+ */
+bool moveFile(const std::string &src, const std::string &dest)
+{
+#ifdef _WIN32
+	return MoveFileExA(src.c_str(), dest.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(src.c_str(), dest.c_str()) == 0;
+#endif
+}
+
+/**
+ * Maps the contents of a file into memory, so they're only
+ * read from disk as they're used. The mapping is private:
+ * the memory can be written to, but the changes are never
+ * written back to the file.
+ * @param path Full path to file.
+ * @param size Pointer to store the size in bytes.
+ * @return Pointer to the contents, or 0 if the file couldn't be mapped.
+ */
+void *mapFile(const std::string &path, size_t *size)
+{
+	void *data = 0;
+	*size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+	DWORD length = GetFileSize(file, 0);
+	if (length != INVALID_FILE_SIZE && length > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (mapping != 0)
+		{
+			data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		if (data != 0)
+		{
+			*size = length;
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return 0;
+	}
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		data = mmap(0, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+		{
+			data = 0;
+		}
+		else
+		{
+			*size = info.st_size;
+		}
+	}
+	::close(file);
+#endif
+	return data;
+}
+
+/**
+ * Releases the memory of a file mapped with mapFile.
+ * @param data Pointer to the contents.
+ * @param size Size in bytes.
+ */
+void unmapFile(void *data, size_t size)
+{
+	if (data == 0)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+/**
+ * Gets the time from the most precise clock available,
+ * for timing things much shorter than SDL_GetTicks can.
+ * Only the difference between two calls is meaningful.
+ * @return Time in microseconds.
+ */
+double getMicroseconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return count.QuadPart * 1000000.0 / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * 1000000.0 + tv.tv_usec;
+#endif
+}
+
 }
 }
@@ -19,6 +19,7 @@
 #ifndef OPENXCOM_CROSSPLATFORM_H
 #define OPENXCOM_CROSSPLATFORM_H
 
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,16 @@ namespace CrossPlatform
 	int createFolder(const char *path);
 	/// Returns the list of files in a folder.
 	std::vector<std::string> getFolderContents(const std::string &path, const std::string &ext = "");
+	/// Gets the modification time and size of a file.
+	bool getFileInfo(const std::string &path, time_t *modified, long *size);
+	/// Replaces a file with another one.
+	bool moveFile(const std::string &src, const std::string &dest);
+	/// Maps a file into memory.
+	void *mapFile(const std::string &path, size_t *size);
+	/// Unmaps a file from memory.
+	void unmapFile(void *data, size_t size);
+	/// Gets the time from a high resolution clock.
+	double getMicroseconds();
 }
 
 }
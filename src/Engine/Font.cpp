@@ -34,7 +34,7 @@ std::wstring Font::_index = L"";
  * @param height Height in pixels of each character.
  * @param spacing Horizontal spacing between each character.
  */
-Font::Font(int width, int height, int spacing) : _width(width), _height(height), _chars(), _spacing(spacing)
+Font::Font(int width, int height, int spacing) : _width(width), _height(height), _chars(), _advance(), _glyphs(), _unknown(0), _spacing(spacing)
 {
 	_surface = new Surface(width, height * _index.length());
 }
@@ -50,10 +50,27 @@ Font::~Font()
 /**
  * Calculates the real size and position of each character in
  * the surface and stores them in SDL_Rect's for future use
- * by other classes.
+ * by other classes. Also builds a table going straight from
+ * each character to its glyph, so text doesn't have to search
+ * for every character it draws or measures.
  */
 void Font::load()
 {
+	_chars.clear();
+	_advance.clear();
+	_glyphs.clear();
+	_unknown = 0;
+
+	wchar_t last = 0;
+	for (unsigned int i = 0; i < _index.length(); ++i)
+	{
+		if (_index[i] > last)
+		{
+			last = _index[i];
+		}
+	}
+	_glyphs.resize(last + 1, -1);
+
 	_surface->lock();
 	for (unsigned int i = 0; i < _index.length(); ++i)
 	{
@@ -86,9 +103,16 @@ void Font::load()
 		rect.w = right - left + 1;
 		rect.h = _height;
 
-		_chars[_index[i]] = rect;
+		_chars.push_back(rect);
+		_advance.push_back(rect.w + _spacing);
+		_glyphs[_index[i]] = i;
 	}
 	_surface->unlock();
+
+	if ('?' < _glyphs.size() && _glyphs['?'] != -1)
+	{
+		_unknown = _glyphs['?'];
+	}
 }
 
 /**
@@ -130,15 +154,54 @@ void Font::loadIndex(const std::string &filename)
  */
 Surface *const Font::getChar(wchar_t c)
 {
-	if (_chars.find(c) == _chars.end())
+	const SDL_Rect &rect = getGlyphRect(getGlyph(c));
+	_surface->getCrop()->x = rect.x;
+	_surface->getCrop()->y = rect.y;
+	_surface->getCrop()->w = rect.w;
+	_surface->getCrop()->h = rect.h;
+	return _surface;
+}
+
+/**
+ * Returns the number of the glyph used to draw a character,
+ * which is its position in the font's surface. Characters
+ * missing from the font are drawn as a question mark.
+ * @param c Character to look up.
+ * @return Glyph number, or -1 if the font isn't loaded.
+ */
+int Font::getGlyph(wchar_t c) const
+{
+	if (c >= 0 && (size_t)c < _glyphs.size() && _glyphs[c] != -1)
 	{
-		c = '?';
+		return _glyphs[c];
 	}
-	_surface->getCrop()->x = _chars[c].x;
-	_surface->getCrop()->y = _chars[c].y;
-	_surface->getCrop()->w = _chars[c].w;
-	_surface->getCrop()->h = _chars[c].h;
-	return _surface;
+	return _chars.empty() ? -1 : _unknown;
+}
+
+/**
+ * Returns the area of the font's surface taken up by a glyph,
+ * trimmed to the glyph's real size.
+ * @param glyph Glyph number.
+ * @return Rectangle in the font's surface.
+ */
+const SDL_Rect &Font::getGlyphRect(int glyph) const
+{
+	return _chars[glyph];
+}
+
+/**
+ * Returns how many pixels a character takes up in a line of text,
+ * including the spacing after it. Spaces are half a character wide.
+ * @param c Character to measure.
+ * @return Width in pixels.
+ */
+int Font::getAdvance(wchar_t c) const
+{
+	if (c == ' ')
+	{
+		return _width / 2;
+	}
+	return _advance[getGlyph(c)];
 }
 /**
  * Returns the maximum width for any character in the font.
@@ -19,8 +19,8 @@
 #ifndef OPENXCOM_FONT_H
 #define OPENXCOM_FONT_H
 
-#include <map>
 #include <string>
+#include <vector>
 #include "SDL.h"
 
 namespace OpenXcom
@@ -41,7 +41,9 @@ private:
 	static std::wstring _index;
 	Surface *_surface;
 	int _width, _height;
-	std::map<wchar_t, SDL_Rect> _chars;
+	std::vector<SDL_Rect> _chars;
+	std::vector<int> _advance, _glyphs;
+	int _unknown;
 	int _spacing; // For some reason the X-Com small font is smooshed together by one pixel...
 public:
 	/// Creates a font with a blank surface.
@@ -54,6 +56,12 @@ public:
 	static void loadIndex(const std::string &filename);
 	/// Gets a particular character from the font, with its real size.
 	Surface *const getChar(wchar_t c);
+	/// Gets the glyph number of a character.
+	int getGlyph(wchar_t c) const;
+	/// Gets the area of a glyph in the font's surface.
+	const SDL_Rect &getGlyphRect(int glyph) const;
+	/// Gets how far a character moves the text along.
+	int getAdvance(wchar_t c) const;
 	/// Gets the font's character width.
 	int getWidth() const;
 	/// Gets the font's character height.
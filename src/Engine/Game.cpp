@@ -19,6 +19,7 @@
 #include "Game.h"
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include "SDL_mixer.h"
 #include "State.h"
 #include "Screen.h"
@@ -34,6 +35,8 @@
 #include "InteractiveSurface.h"
 #include "Options.h"
 #include "CrossPlatform.h"
+#include "Timer.h"
+#include "Profiler.h"
 
 namespace OpenXcom
 {
@@ -48,7 +51,7 @@ namespace OpenXcom
  * @warning Currently the game is designed for 8bpp, so there's no telling what'll
  * happen if you use a different value.
  */
-Game::Game(const std::string &title, int width, int height, int bpp) : _screen(0), _cursor(0), _lang(0), _states(), _deleted(), _res(0), _save(0), _rules(0), _quit(false), _init(false)
+Game::Game(const std::string &title, int width, int height, int bpp) : _screen(0), _cursor(0), _lang(0), _states(), _deleted(), _res(0), _save(0), _rules(0), _quit(false), _init(false), _redraw(true), _fpsCounter(0), _lastRender(0), _nextRender(0)
 {
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -93,7 +96,7 @@ Game::Game(const std::string &title, int width, int height, int bpp) : _screen(0
 	_cursor->setColor(Palette::blockOffset(15)+12);
 
 	// Create fps counter
-	_fpsCounter = new FpsCounter(15, 5, 0, 0);
+	_fpsCounter = new FpsCounter(224, 64, 0, 0);
 
 	// Create blank language
 	_lang = new Language();
@@ -128,9 +131,15 @@ Game::~Game()
  * The state machine takes care of passing all the events from SDL to the
  * active state, running any code within and blitting all the states and
  * cursor to the screen. This is run indefinitely until the game quits.
+ * The screen is only redrawn when something could have changed it, and
+ * no faster than the frame rate, and in between the game sleeps until
+ * the next timer goes off or the player does something.
  */
 void Game::run()
 {
+	int frameRate = Options::getInt("frameRate");
+	Uint32 frameTime = (frameRate > 0) ? 1000 / frameRate : 0;
+
 	while (!_quit)
 	{
 		// Clean up states
@@ -145,6 +154,13 @@ void Game::run()
 		{
 			_states.back()->init();
 			_init = true;
+			_redraw = true;
+
+			// Let go of resources the previous screens were using
+			if (_res != 0)
+			{
+				_res->trim();
+			}
 
 			// Unpress buttons
 			_states.back()->resetAll();
@@ -175,33 +191,101 @@ void Game::run()
 				_fpsCounter->handle(&action);
 				_states.back()->handle(&action);
 			}
+			_redraw = true;
 		}
 
 		// Process logic
+		Timer::resetActivity();
 		_fpsCounter->think();
-		_states.back()->think();
+		{
+			Profiler::Scope scope(Profiler::ZONE_THINK);
+			_states.back()->think();
+		}
+		if (Timer::hasFired())
+		{
+			_redraw = true;
+		}
 
-		// Process rendering
-		if (_init)
+		// Process rendering, redrawing every now and then even when
+		// idle in case something changed without a timer or event
+		Uint32 now = SDL_GetTicks();
+		if (_init && now >= _nextRender && (_redraw || now - _lastRender >= IDLE_REDRAW_INTERVAL))
 		{
-			_screen->clear();
-			std::list<State*>::iterator i = _states.end();
-			do
 			{
-				--i;
+				Profiler::Scope scope(Profiler::ZONE_BLIT);
+				_screen->clear();
+				std::list<State*>::iterator i = _states.end();
+				do
+				{
+					--i;
+				}
+				while(i != _states.begin() && !(*i)->isScreen());
+
+				for (; i != _states.end(); ++i)
+				{
+					(*i)->blit();
+				}
+				_fpsCounter->blit(_screen->getSurface());
+				_cursor->blit(_screen->getSurface());
 			}
-			while(i != _states.begin() && !(*i)->isScreen());
-
-			for (; i != _states.end(); ++i)
 			{
-				(*i)->blit();
+				Profiler::Scope scope(Profiler::ZONE_FLIP);
+				_screen->flip();
 			}
-			_fpsCounter->blit(_screen->getSurface());
-			_cursor->blit(_screen->getSurface());
+			_fpsCounter->addFrame();
+			Profiler::endFrame();
+
+			_redraw = false;
+			_lastRender = now;
+			_nextRender = now + frameTime;
 		}
-		_screen->flip();
 
-		SDL_Delay(0);
+		// Wait for something to do
+		if (!_init || _quit || _states.back()->isBusy())
+		{
+			SDL_Delay(0);
+		}
+		else if (_redraw)
+		{
+			wait(std::min(Timer::getNextDeadline(), _nextRender), false);
+		}
+		else
+		{
+			wait(std::min(Timer::getNextDeadline(), _lastRender + IDLE_REDRAW_INTERVAL), true);
+		}
+	}
+}
+
+/**
+ * Sleeps until a certain time, optionally waking up early
+ * when there's input waiting to be handled. SDL can't wait
+ * for events with a timeout, so they're checked in short naps.
+ * @param deadline Time to wake up, as given by SDL_GetTicks.
+ * @param wakeOnInput Wake up as soon as there's input?
+ */
+void Game::wait(Uint32 deadline, bool wakeOnInput)
+{
+	Uint32 now = SDL_GetTicks();
+	while (now < deadline)
+	{
+		if (!wakeOnInput)
+		{
+			SDL_Delay(deadline - now);
+			return;
+		}
+		SDL_PumpEvents();
+		SDL_Event event;
+		if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0)
+		{
+			return;
+		}
+		Uint32 nap = deadline - now;
+		if (nap > INPUT_POLL_INTERVAL)
+		{
+			nap = INPUT_POLL_INTERVAL;
+		}
+		SDL_Delay(nap);
+		now = SDL_GetTicks();
 	}
 }
 
@@ -271,6 +355,7 @@ void Game::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 	_cursor->draw();
 
 	_fpsCounter->setPalette(colors, firstcolor, ncolors);
+	_redraw = true;
 
 	if (_res != 0)
 	{
@@ -367,6 +452,10 @@ ResourcePack *const Game::getResourcePack() const
 void Game::setResourcePack(ResourcePack *res)
 {
 	_res = res;
+	if (_res != 0)
+	{
+		_fpsCounter->setFonts(_res->getFont("Big.fnt"), _res->getFont("Small.fnt"));
+	}
 }
 
 /**
@@ -52,8 +52,13 @@ private:
 	ResourcePack *_res;
 	SavedGame *_save;
 	Ruleset *_rules;
-	bool _quit, _init;
+	static const Uint32 IDLE_REDRAW_INTERVAL = 250;
+	static const Uint32 INPUT_POLL_INTERVAL = 5;
+	bool _quit, _init, _redraw;
 	FpsCounter *_fpsCounter;
+	Uint32 _lastRender, _nextRender;
+	/// Sleeps until a certain time.
+	void wait(Uint32 deadline, bool wakeOnInput);
 public:
 	/// Creates a new game and initializes SDL.
 	Game(const std::string &title, int width, int height, int bpp);
@@ -64,6 +64,20 @@ void createDefault()
 	setBool("battlePreviewPath", false);
 	setBool("battleRangeBasedAccuracy", false);
 	setBool("fpsCounter", false);
+	// set to false to save battlescape tiles as readable YAML instead of packed binary data
+	setBool("battleBinarySave", true);
+	// number of extra threads used to decode resource files at startup
+	setInt("loadingThreads", 4);
+	// memory budget in KB for images and music that are only loaded when needed, 0 keeps everything loaded
+	setInt("resourceBudget", 0);
+	// keep decoded sprites and terrain in a cache file in the user folder for faster loading
+	setBool("assetCache", true);
+	// maximum frames drawn per second, 0 for no limit
+	setInt("frameRate", 60);
+	// time parts of every frame and show them under the FPS counter, toggled with F6
+	setBool("profiler", false);
+	// record every profiler timing and write it to trace.json in the user folder on exit
+	setBool("profilerTrace", false);
 }
 
 /**
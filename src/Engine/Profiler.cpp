@@ -0,0 +1,248 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Profiler.h"
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include "CrossPlatform.h"
+#include "Options.h"
+
+namespace OpenXcom
+{
+namespace Profiler
+{
+
+/// Most timings recorded for the trace, so it doesn't eat up all the memory.
+const size_t MAX_TRACE_EVENTS = 1000000;
+
+/**
+ * A single timing recorded for the trace.
+ */
+struct TraceEvent
+{
+	int zone;
+	double start, duration;
+};
+
+const char *_names[] = { "think", "blit", "flip", "TileEngine", "Pathfinding", "AI" };
+bool _enabled = false, _trace = false;
+int _depth[ZONE_TOTAL];
+double _current[ZONE_TOTAL];
+double _total[ZONE_TOTAL];
+double _history[HISTORY][ZONE_TOTAL];
+int _frame = 0;
+double _frameStart = 0.0;
+std::vector<TraceEvent> _events;
+
+/**
+ * Records a timing for the trace, if there's one being recorded.
+ * @param zone Zone index, or ZONE_TOTAL for a whole frame.
+ * @param start Start time in microseconds.
+ * @param end End time in microseconds.
+ */
+static void record(int zone, double start, double end)
+{
+	if (_trace && _events.size() < MAX_TRACE_EVENTS)
+	{
+		TraceEvent event;
+		event.zone = zone;
+		event.start = start;
+		event.duration = end - start;
+		_events.push_back(event);
+	}
+}
+
+/**
+ * Starts timing a zone, if the profiler is on.
+ * @param zone Zone to time.
+ */
+Scope::Scope(Zone zone) : _zone(zone), _start(0.0), _counted(_enabled), _active(false)
+{
+	if (_counted && _depth[_zone]++ == 0)
+	{
+		_active = true;
+		_start = CrossPlatform::getMicroseconds();
+	}
+}
+
+/**
+ * Adds the time spent since the scope was created
+ * to its zone for the current frame.
+ */
+Scope::~Scope()
+{
+	if (_active)
+	{
+		double end = CrossPlatform::getMicroseconds();
+		_current[_zone] += end - _start;
+		_total[_zone] += end - _start;
+		record(_zone, _start, end);
+	}
+	if (_counted)
+	{
+		_depth[_zone]--;
+	}
+}
+
+/**
+ * Turns the profiler on if the options say so, and
+ * starts recording a trace if that's asked for too.
+ */
+void init()
+{
+	_trace = Options::getBool("profilerTrace");
+	setEnabled(Options::getBool("profiler"));
+}
+
+/**
+ * Turns the profiler on or off. Turning it on starts
+ * over with an empty history.
+ * @param enabled Is the profiler on?
+ */
+void setEnabled(bool enabled)
+{
+	if (enabled && !_enabled)
+	{
+		for (int i = 0; i < ZONE_TOTAL; ++i)
+		{
+			_depth[i] = 0;
+			_current[i] = 0.0;
+			_total[i] = 0.0;
+			for (int j = 0; j < HISTORY; ++j)
+			{
+				_history[j][i] = 0.0;
+			}
+		}
+		_frameStart = CrossPlatform::getMicroseconds();
+	}
+	_enabled = enabled;
+}
+
+/**
+ * Returns if the profiler is timing zones.
+ * @return True if it's on.
+ */
+bool isEnabled()
+{
+	return _enabled;
+}
+
+/**
+ * Moves the times spent in each zone since the last frame
+ * into the history, and starts timing a new frame.
+ */
+void endFrame()
+{
+	if (!_enabled)
+		return;
+	_frame = (_frame + 1) % HISTORY;
+	for (int i = 0; i < ZONE_TOTAL; ++i)
+	{
+		_history[_frame][i] = _current[i];
+		_current[i] = 0.0;
+	}
+	double now = CrossPlatform::getMicroseconds();
+	record(ZONE_TOTAL, _frameStart, now);
+	_frameStart = now;
+}
+
+/**
+ * Returns how long was spent in a zone in one of the
+ * frames kept in the history.
+ * @param zone Zone to check.
+ * @param frame How many frames ago, 0 being the last one.
+ * @return Time in microseconds.
+ */
+double getTime(Zone zone, int frame)
+{
+	return _history[(_frame - frame + HISTORY) % HISTORY][zone];
+}
+
+/**
+ * Returns the average time spent in a zone per frame,
+ * over all the frames kept in the history.
+ * @param zone Zone to check.
+ * @return Time in microseconds.
+ */
+double getAverage(Zone zone)
+{
+	double total = 0.0;
+	for (int i = 0; i < HISTORY; ++i)
+	{
+		total += _history[i][zone];
+	}
+	return total / HISTORY;
+}
+
+/**
+ * Returns the time spent in a zone since the profiler was
+ * last turned on, for timing things that don't run in frames.
+ * @param zone Zone to check.
+ * @return Time in microseconds.
+ */
+double getTotal(Zone zone)
+{
+	return _total[zone];
+}
+
+/**
+ * Returns the name of a zone, as shown in the trace.
+ * @param zone Zone to check.
+ * @return Zone name.
+ */
+const char *getName(Zone zone)
+{
+	return _names[zone];
+}
+
+/**
+ * Writes every timing recorded so far to trace.json in the
+ * user folder, in the Chrome trace event format, so it can
+ * be opened in chrome://tracing or Perfetto.
+ */
+void save()
+{
+	if (_events.empty())
+		return;
+	std::string filename = Options::getUserFolder() + "trace.json";
+	std::ofstream out(filename.c_str());
+	if (!out)
+	{
+		std::cerr << "ERROR: Failed to save " << filename << std::endl;
+		return;
+	}
+	out.setf(std::ios::fixed);
+	out.precision(1);
+	out << "{\"traceEvents\":[" << std::endl;
+	for (std::vector<TraceEvent>::iterator i = _events.begin(); i != _events.end(); ++i)
+	{
+		const char *name = (i->zone == ZONE_TOTAL) ? "frame" : _names[i->zone];
+		int thread = (i->zone == ZONE_TOTAL) ? 0 : 1;
+		out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+			<< ",\"ts\":" << i->start << ",\"dur\":" << i->duration << "}";
+		if (i + 1 != _events.end())
+			out << ",";
+		out << std::endl;
+	}
+	out << "]}" << std::endl;
+	_events.clear();
+}
+
+}
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PROFILER_H
+#define OPENXCOM_PROFILER_H
+
+namespace OpenXcom
+{
+
+/**
+ * Built-in frame profiler. Times a few parts of the game
+ * on every frame so stalls can be tracked down without an
+ * external profiler, keeps a short history for the overlay
+ * and can record every timing as a Chrome trace.
+ * Only meant to be used from the main thread.
+ */
+namespace Profiler
+{
+	/// Parts of the game that are timed separately.
+	enum Zone { ZONE_THINK, ZONE_BLIT, ZONE_FLIP, ZONE_TILEENGINE, ZONE_PATHFINDING, ZONE_AI, ZONE_TOTAL };
+	/// Number of frames kept in the history.
+	const int HISTORY = 128;
+
+	/**
+	 * Times a zone from its creation until it goes out of scope.
+	 * A zone entered again while it's already being timed,
+	 * like a function calling itself, is only timed once.
+	 */
+	class Scope
+	{
+	private:
+		Zone _zone;
+		double _start;
+		bool _counted, _active;
+	public:
+		/// Starts timing a zone.
+		Scope(Zone zone);
+		/// Stops timing the zone.
+		~Scope();
+	};
+
+	/// Sets up the profiler from the options.
+	void init();
+	/// Turns the profiler on or off.
+	void setEnabled(bool enabled);
+	/// Gets if the profiler is on.
+	bool isEnabled();
+	/// Finishes timing a frame.
+	void endFrame();
+	/// Gets the time spent in a zone in a past frame.
+	double getTime(Zone zone, int frame);
+	/// Gets the average time spent in a zone per frame.
+	double getAverage(Zone zone);
+	/// Gets the time spent in a zone since the profiler was turned on.
+	double getTotal(Zone zone);
+	/// Gets the name of a zone.
+	const char *getName(Zone zone);
+	/// Writes the recorded trace to a file.
+	void save();
+}
+
+}
+
+#endif
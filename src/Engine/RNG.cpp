@@ -19,8 +19,8 @@
 #include "RNG.h"
 #define _USE_MATH_DEFINES
 #include <cmath>
-#include <cstdlib>
 #include <ctime>
+#include <sstream>
 
 namespace OpenXcom
 {
@@ -28,32 +28,71 @@ namespace RNG
 {
 
 int _seed = 0;
+Generator _streams[STREAM_TOTAL];
 
 /**
- * Seeds the random generator with a new number.
- * Defaults to the current time if none is set.
+ * Scrambles a number with the SplitMix64 generator,
+ * used to spread a seed over the generator state.
+ * @param x Number to scramble, advanced in place.
+ * @return Scrambled number.
+ */
+static Uint64 splitMix(Uint64 &x)
+{
+	Uint64 z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Rotates a number to the left.
+ * @param x Number to rotate.
+ * @param k Number of bits.
+ * @return Rotated number.
+ */
+static inline Uint64 rotl(Uint64 x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Creates a generator with a certain seed.
+ * @param seed Initial seed.
+ */
+Generator::Generator(Uint64 seed) : _normal(0.0), _hasNormal(false)
+{
+	this->seed(seed);
+}
+
+/**
+ * Resets the generator state from a seed.
  * @param seed New seed.
  */
-void init(int seed)
+void Generator::seed(Uint64 seed)
 {
-	if (seed == -1)
+	for (int i = 0; i < 4; ++i)
 	{
-		_seed = (int)time(NULL);
+		_state[i] = splitMix(seed);
 	}
-	else
-	{
-		_seed = seed;
-	}
-	srand(_seed);
+	_hasNormal = false;
 }
 
 /**
- * Returns the last seed used by the generator.
- * @return Generator seed.
+ * Advances the generator and returns the next
+ * number in its sequence.
+ * @return Uniformly distributed 64-bit number.
  */
-int getSeed()
+Uint64 Generator::next()
 {
-	return _seed;
+	Uint64 result = rotl(_state[1] * 5, 7) * 9;
+	Uint64 t = _state[1] << 17;
+	_state[2] ^= _state[0];
+	_state[3] ^= _state[1];
+	_state[1] ^= _state[2];
+	_state[0] ^= _state[3];
+	_state[2] ^= t;
+	_state[3] = rotl(_state[3], 45);
+	return result;
 }
 
 /**
@@ -62,10 +101,14 @@ int getSeed()
  * @param max Maximum number.
  * @return Generated number.
  */
-int generate(int min, int max)
+int Generator::generate(int min, int max)
 {
-	_seed = rand();
-	return (_seed % (max - min + 1) + min);
+	if (max <= min)
+	{
+		return min;
+	}
+	Uint64 range = (Uint64)((Sint64)max - min + 1);
+	return (int)((Sint64)min + (Sint64)(next() % range));
 }
 
 /**
@@ -74,10 +117,11 @@ int generate(int min, int max)
  * @param max Maximum number.
  * @return Generated number.
  */
-double generate(double min, double max)
+double Generator::generate(double min, double max)
 {
-	_seed = rand();
-	return (_seed * (max - min) / RAND_MAX + min);
+	// top 53 bits fill the mantissa of a double in [0, 1)
+	double x = (next() >> 11) * (1.0 / 9007199254740992.0);
+	return (x * (max - min) + min);
 }
 
 /**
@@ -86,16 +130,14 @@ double generate(double min, double max)
  * @param s standard deviation
  * @return normally distributed value.
  */
-double boxMuller(double m, double s)
+double Generator::boxMuller(double m, double s)
 {
 	double y1;
-	static double y2;
-	static int use_last = 0;
 
-	if (use_last)				/* use value from previous call */
+	if (_hasNormal)				/* use value from previous call */
 	{
-		y1 = y2;
-		use_last = 0;
+		y1 = _normal;
+		_hasNormal = false;
 	}
 	else
 	{
@@ -104,16 +146,196 @@ double boxMuller(double m, double s)
 			x1 = 2.0 * generate(0.0, 1.0) - 1.0;
 			x2 = 2.0 * generate(0.0, 1.0) - 1.0;
 			w = x1 * x1 + x2 * x2;
-		} while ( w >= 1.0 );
+		} while ( w >= 1.0 || w == 0.0 );
 
 		w = sqrt( (-2.0 * log( w ) ) / w );
 		y1 = x1 * w;
-		y2 = x2 * w;
-		use_last = 1;
+		_normal = x2 * w;
+		_hasNormal = true;
 	}
 
 	return( m + y1 * s );
 }
 
+/**
+ * Loads the generator state from a YAML file.
+ * The state words are stored as hex strings since
+ * not every YAML reader handles 64-bit integers.
+ * @param node YAML node.
+ */
+void Generator::load(const YAML::Node &node)
+{
+	for (int i = 0; i < 4 && i < (int)node.size(); ++i)
+	{
+		std::string s;
+		node[i] >> s;
+		std::istringstream ss(s);
+		ss >> std::hex >> _state[i];
+	}
+	_hasNormal = false;
+}
+
+/**
+ * Saves the generator state to a YAML file.
+ * @param out YAML emitter.
+ */
+void Generator::save(YAML::Emitter &out) const
+{
+	out << YAML::Flow << YAML::BeginSeq;
+	for (int i = 0; i < 4; ++i)
+	{
+		std::ostringstream ss;
+		ss << std::hex << _state[i];
+		out << ss.str();
+	}
+	out << YAML::EndSeq;
+}
+
+/**
+ * Seeds all the random streams from a new number.
+ * Defaults to the current time if none is set.
+ * @param seed New seed.
+ */
+void init(int seed)
+{
+	if (seed == -1)
+	{
+		_seed = (int)time(NULL);
+	}
+	else
+	{
+		_seed = seed;
+	}
+	Uint64 x = (Uint32)_seed;
+	for (int i = 0; i < STREAM_TOTAL; ++i)
+	{
+		_streams[i].seed(splitMix(x));
+	}
+}
+
+/**
+ * Returns the last seed used by the generator.
+ * @return Generator seed.
+ */
+int getSeed()
+{
+	return _seed;
+}
+
+/**
+ * Returns the generator behind a random stream,
+ * for code that wants to hold on to it.
+ * @param stream Stream to get.
+ * @return Pointer to the generator.
+ */
+Generator *getGenerator(Stream stream)
+{
+	return &_streams[stream];
+}
+
+/**
+ * Generates a random integer number within a certain range
+ * from the default stream.
+ * @param min Minimum number.
+ * @param max Maximum number.
+ * @return Generated number.
+ */
+int generate(int min, int max)
+{
+	return _streams[STREAM_DEFAULT].generate(min, max);
+}
+
+/**
+ * Generates a random decimal number within a certain range
+ * from the default stream.
+ * @param min Minimum number.
+ * @param max Maximum number.
+ * @return Generated number.
+ */
+double generate(double min, double max)
+{
+	return _streams[STREAM_DEFAULT].generate(min, max);
+}
+
+/**
+ * Generates a normally distributed number
+ * from the default stream.
+ * @param m mean
+ * @param s standard deviation
+ * @return normally distributed value.
+ */
+double boxMuller(double m, double s)
+{
+	return _streams[STREAM_DEFAULT].boxMuller(m, s);
+}
+
+/**
+ * Generates a random integer number within a certain range.
+ * @param stream Stream to draw from.
+ * @param min Minimum number.
+ * @param max Maximum number.
+ * @return Generated number.
+ */
+int generate(Stream stream, int min, int max)
+{
+	return _streams[stream].generate(min, max);
+}
+
+/**
+ * Generates a random decimal number within a certain range.
+ * @param stream Stream to draw from.
+ * @param min Minimum number.
+ * @param max Maximum number.
+ * @return Generated number.
+ */
+double generate(Stream stream, double min, double max)
+{
+	return _streams[stream].generate(min, max);
+}
+
+/**
+ * Generates a normally distributed number.
+ * @param stream Stream to draw from.
+ * @param m mean
+ * @param s standard deviation
+ * @return normally distributed value.
+ */
+double boxMuller(Stream stream, double m, double s)
+{
+	return _streams[stream].boxMuller(m, s);
+}
+
+/**
+ * Loads the seed and the state of every stream from a YAML file.
+ * @param node YAML node.
+ */
+void load(const YAML::Node &node)
+{
+	node["seed"] >> _seed;
+	const YAML::Node &streams = node["streams"];
+	for (int i = 0; i < STREAM_TOTAL && i < (int)streams.size(); ++i)
+	{
+		_streams[i].load(streams[i]);
+	}
+}
+
+/**
+ * Saves the seed and the state of every stream to a YAML file.
+ * @param out YAML emitter.
+ */
+void save(YAML::Emitter &out)
+{
+	out << YAML::BeginMap;
+	out << YAML::Key << "seed" << YAML::Value << _seed;
+	out << YAML::Key << "streams" << YAML::Value;
+	out << YAML::BeginSeq;
+	for (int i = 0; i < STREAM_TOTAL; ++i)
+	{
+		_streams[i].save(out);
+	}
+	out << YAML::EndSeq;
+	out << YAML::EndMap;
+}
+
+}
 }
-}
\ No newline at end of file
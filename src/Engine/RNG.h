@@ -19,27 +19,76 @@
 #ifndef OPENXCOM_RNG_H
 #define OPENXCOM_RNG_H
 
+#include "SDL.h"
+#include "yaml.h"
+
 namespace OpenXcom
 {
 
 /**
  * Random Number Generator used throughout the game
- * for all your randomness needs. It's really just the
- * standard C generator, but wrapped in a way that we
- * can store its seed for later use if necessary.
+ * for all your randomness needs. Each subsystem draws
+ * from its own stream so they don't disturb each other,
+ * and the state of every stream can be stored in the
+ * savegame so a game can be replayed exactly.
  */
 namespace RNG
 {
+	/// Independent streams of random numbers.
+	enum Stream { STREAM_DEFAULT, STREAM_MAPGEN, STREAM_AI, STREAM_COMBAT, STREAM_GEOSCAPE, STREAM_TOTAL };
+
+	/**
+	 * A xoshiro256** pseudo-random number generator.
+	 * Keeps all of its state in the object, so several can
+	 * run side by side without sharing anything.
+	 */
+	class Generator
+	{
+	private:
+		Uint64 _state[4];
+		double _normal;
+		bool _hasNormal;
+	public:
+		/// Creates a generator with a seed.
+		Generator(Uint64 seed = 0);
+		/// Seeds the generator.
+		void seed(Uint64 seed);
+		/// Generates the next raw 64-bit number.
+		Uint64 next();
+		/// Generates a random integer number.
+		int generate(int min, int max);
+		/// Generates a random decimal number.
+		double generate(double min, double max);
+		/// Get normally distributed value.
+		double boxMuller(double m, double s);
+		/// Loads the generator state from YAML.
+		void load(const YAML::Node& node);
+		/// Saves the generator state to YAML.
+		void save(YAML::Emitter& out) const;
+	};
+
 	/// Initializes the generator.
 	void init(int seed = -1);
 	/// Gets the generator's seed.
 	int getSeed();
+	/// Gets the generator of a stream.
+	Generator *getGenerator(Stream stream);
 	/// Generates a random integer number.
 	int generate(int min, int max);
 	/// Generates a random decimal number.
 	double generate(double min, double max);
 	/// Get normally distributed value.
 	double boxMuller(double m = 0, double s = 1);
+	/// Generates a random integer number from a stream.
+	int generate(Stream stream, int min, int max);
+	/// Generates a random decimal number from a stream.
+	double generate(Stream stream, double min, double max);
+	/// Get normally distributed value from a stream.
+	double boxMuller(Stream stream, double m, double s);
+	/// Loads the state of all streams from YAML.
+	void load(const YAML::Node& node);
+	/// Saves the state of all streams to YAML.
+	void save(YAML::Emitter& out);
 }
 
 }
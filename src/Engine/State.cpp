@@ -150,6 +150,18 @@ void State::think()
 		(*i)->think();
 }
 
+/**
+ * Returns if the state needs to think again right away,
+ * instead of waiting for input or its timers. States
+ * that do work every cycle outside of timers, like
+ * loading or AI turns, should override this.
+ * @return True if the game shouldn't sleep.
+ */
+bool State::isBusy() const
+{
+	return false;
+}
+
 /**
  * Takes care of any events from the core game engine,
  * and passes them on to its InteractiveSurface child elements.
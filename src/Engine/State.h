@@ -62,6 +62,8 @@ public:
 	virtual void handle(Action *action);
 	/// Runs state functionality every cycle.
 	virtual void think();
+	/// Checks if the state has work to do on the next cycle.
+	virtual bool isBusy() const;
 	/// Blits the state to the screen.
 	virtual void blit();
 	/// Hides all the state surfaces.
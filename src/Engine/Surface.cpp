@@ -36,7 +36,7 @@ namespace OpenXcom
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-Surface::Surface(int width, int height, int x, int y) : _x(x), _y(y), _visible(true), _hidden(false), _redraw(false), _originalColors(0)
+Surface::Surface(int width, int height, int x, int y) : _x(x), _y(y), _visible(true), _hidden(false), _redraw(false), _originalColors(0), _spans(), _spanRows(), _spansValid(false), _opaqueTop(0), _opaqueBottom(0)
 {
 	_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 8, 0, 0, 0, 0);
 
@@ -53,11 +53,37 @@ Surface::Surface(int width, int height, int x, int y) : _x(x), _y(y), _visible(t
 	_crop.y = 0;
 }
 
+/**
+ * Sets up an 8bpp surface on top of pixels owned by someone
+ * else, such as a mapped file, without copying them.
+ * The pixels must outlive the surface.
+ * @param pixels Pointer to the pixel data.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param pitch Bytes between the start of each row.
+ */
+Surface::Surface(Uint8 *pixels, int width, int height, int pitch) : _x(0), _y(0), _visible(true), _hidden(false), _redraw(false), _originalColors(0), _spans(), _spanRows(), _spansValid(false), _opaqueTop(0), _opaqueBottom(0)
+{
+	_surface = SDL_CreateRGBSurfaceFrom(pixels, width, height, 8, pitch, 0, 0, 0, 0);
+
+	if (_surface == 0)
+	{
+		throw Exception(SDL_GetError());
+	}
+
+	SDL_SetColorKey(_surface, SDL_SRCCOLORKEY, 0);
+
+	_crop.w = 0;
+	_crop.h = 0;
+	_crop.x = 0;
+	_crop.y = 0;
+}
+
 /**
  * Performs a deep copy of an existing surface.
  * @param other Surface to copy from.
  */
-Surface::Surface(const Surface& other)
+Surface::Surface(const Surface& other) : _spans(), _spanRows(), _spansValid(false), _opaqueTop(0), _opaqueBottom(0)
 {
 	_surface = SDL_ConvertSurface(other._surface, other._surface->format, other._surface->flags);
 	_x = other._x;
@@ -179,6 +205,7 @@ void Surface::clear()
 	square.w = getWidth();
 	square.h = getHeight();
 	SDL_FillRect(_surface, &square, 0);
+	_spansValid = false;
 }
 
 /**
@@ -308,6 +335,7 @@ void Surface::blit(Surface *surface)
 		target.x = getX();
 		target.y = getY();
 		SDL_BlitSurface(_surface, cropper, surface->getSurface(), &target);
+		surface->_spansValid = false;
 	}
 }
 
@@ -326,6 +354,7 @@ void Surface::copy(Surface *surface)
 	from.w = getWidth();
 	from.h = getHeight();
 	SDL_BlitSurface(surface->getSurface(), &from, _surface, 0);
+	_spansValid = false;
 }
 
 /**
@@ -336,6 +365,7 @@ void Surface::copy(Surface *surface)
 void Surface::drawRect(SDL_Rect *rect, Uint8 color)
 {
 	SDL_FillRect(_surface, rect, color);
+	_spansValid = false;
 }
 
 /**
@@ -349,6 +379,7 @@ void Surface::drawRect(SDL_Rect *rect, Uint8 color)
 void Surface::drawLine(Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uint8 color)
 {
 	lineColor(_surface, x1, y1, x2, y2, Palette::getRGBA(getPalette(), color));
+	_spansValid = false;
 }
 
 /**
@@ -361,6 +392,7 @@ void Surface::drawLine(Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uint8 color)
 void Surface::drawCircle(Sint16 x, Sint16 y, Sint16 r, Uint8 color)
 {
 	filledCircleColor(_surface, x, y, r, Palette::getRGBA(getPalette(), color));
+	_spansValid = false;
 }
 
 /**
@@ -373,6 +405,7 @@ void Surface::drawCircle(Sint16 x, Sint16 y, Sint16 r, Uint8 color)
 void Surface::drawPolygon(Sint16 *x, Sint16 *y, int n, Uint8 color)
 {
 	filledPolygonColor(_surface, x, y, n, Palette::getRGBA(getPalette(), color));
+	_spansValid = false;
 }
 
 /**
@@ -387,6 +420,7 @@ void Surface::drawPolygon(Sint16 *x, Sint16 *y, int n, Uint8 color)
 void Surface::drawTexturedPolygon(Sint16 *x, Sint16 *y, int n, Surface *texture, int dx, int dy)
 {
 	texturedPolygon(_surface, x, y, n, texture->getSurface(), dx, dy);
+	_spansValid = false;
 }
 
 /**
@@ -399,6 +433,7 @@ void Surface::drawTexturedPolygon(Sint16 *x, Sint16 *y, int n, Surface *texture,
 void Surface::drawString(Sint16 x, Sint16 y, const char *s, Uint8 color)
 {
 	stringColor(_surface, x, y, s, Palette::getRGBA(getPalette(), color));
+	_spansValid = false;
 }
 
 /**
@@ -511,6 +546,7 @@ void Surface::setPixel(int x, int y, Uint8 pixel)
 		return;
 	}
 	((Uint8 *)_surface->pixels)[y * _surface->pitch + x * _surface->format->BytesPerPixel] = pixel;
+	_spansValid = false;
 }
 
 /**
@@ -590,6 +626,8 @@ void Surface::setHidden(bool hidden)
 void Surface::lock()
 {
 	SDL_LockSurface(_surface);
+	// the pixels are about to be changed
+	_spansValid = false;
 }
 
 /**
@@ -656,8 +694,104 @@ void Surface::paletteRestore()
 	}
 }
 
+/// Number of shade levels with a precomputed table, any darker shade looks the same as the last one.
+static const int SHADE_LEVELS = 17;
+
+/**
+ * Fills a table with the shaded color of every palette index.
+ * @param table Table of 256 colors to fill.
+ * @param off Amount to darken the colors.
+ * @param newBaseColor Attention: the actual color + 1, because 0 is no new base color.
+ */
+static void buildShadeTable(Uint8 *table, int off, int newBaseColor)
+{
+	for (int pixel = 0; pixel < 256; ++pixel)
+	{
+		int baseColor;
+		if (newBaseColor)
+			baseColor = newBaseColor - 1;
+		else
+			baseColor = pixel>>4;
+
+		int newShade = (pixel&15) + off;
+		if (newShade > 15)
+		{
+			// so dark it would flip over to another color - make it black instead
+			baseColor = 0;
+			newShade = 15;
+		}
+		table[pixel] = (baseColor<<4) | newShade;
+	}
+}
+
+/**
+ * Gets the precomputed table for a shade level.
+ * @param off Amount to darken the colors, 0 to SHADE_LEVELS - 1.
+ * @return Table of 256 colors.
+ */
+static const Uint8 *getShadeTable(int off)
+{
+	static Uint8 tables[SHADE_LEVELS][256];
+	static bool built = false;
+	if (!built)
+	{
+		for (int i = 0; i < SHADE_LEVELS; ++i)
+		{
+			buildShadeTable(tables[i], i, 0);
+		}
+		built = true;
+	}
+	return tables[off];
+}
+
+/**
+ * Encodes the runs of non-transparent pixels in every row of the surface,
+ * so blitNShade can skip transparent pixels without looking at them.
+ * For each row the spans hold the number of runs followed by the start
+ * and length of each run. The first and last rows with any runs are
+ * kept too, so fully transparent rows aren't visited at all.
+ */
+void Surface::buildSpans()
+{
+	Uint8 *src = (Uint8*) _surface->pixels;
+	int w = getWidth();
+	int h = getHeight();
+
+	_spans.clear();
+	_spanRows.resize(h);
+	_opaqueTop = h;
+	_opaqueBottom = 0;
+	for (int y = 0; y < h; ++y, src += _surface->pitch)
+	{
+		_spanRows[y] = _spans.size();
+		_spans.push_back(0);
+		int x = 0;
+		while (x < w)
+		{
+			while (x < w && !src[x])
+				++x;
+			int start = x;
+			while (x < w && src[x])
+				++x;
+			if (x > start)
+			{
+				_spans[_spanRows[y]]++;
+				_spans.push_back(start);
+				_spans.push_back(x - start);
+			}
+		}
+		if (_spans[_spanRows[y]] != 0)
+		{
+			_opaqueTop = std::min(_opaqueTop, y);
+			_opaqueBottom = y + 1;
+		}
+	}
+	_spansValid = true;
+}
+
 /**
  * Specific blit function to blit battlescape terrain data in different shades in a fast way.
+ * The colors come from a table per shade, and only the runs of non-transparent pixels are visited.
  * Notice there is no surface locking here - you have to make sure you lock the surface yourself
  * at the start of blitting and unlock it when done.
  * @param surface to blit to
@@ -672,9 +806,8 @@ void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int
 	// get Width and Height only once
 	int w = getWidth();
 	int h = getHeight();
-	int dw = surface->getWidth();
-	int dh = surface->getHeight();
-	int baseColor;
+	// stay inside the clipping rectangle of the destination
+	const SDL_Rect &clip = surface->getSurface()->clip_rect;
 
 	// get src and dest memory (so there's no need to use getPixel & setPixel)
 	Uint8* src = (Uint8*) getSurface()->pixels;
@@ -683,34 +816,50 @@ void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int
 	int spitch = getSurface()->pitch;
 	int dpitch = surface->getSurface()->pitch;
 
-	const int start_x = std::max((half)? w/2 : 0, -x);
-	const int start_y = std::max(0, -y);
-	const int end_x = std::min( w, dw - x);
-	const int end_y = std::min( h, dh - y);
+	const int start_x = std::max((half)? w/2 : 0, clip.x - x);
+	const int start_y = std::max(0, clip.y - y);
+	const int end_x = std::min( w, clip.x + clip.w - x);
+	const int end_y = std::min( h, clip.y + clip.h - y);
+
+	if (start_x >= end_x || start_y >= end_y)
+		return;
 
-	int dest_y = (y + start_y) * dpitch + x;
-	int src_y = start_y * spitch;
-	for(int iy = start_y; iy < end_y; ++iy, dest_y += dpitch, src_y += spitch)
-		for(int ix = start_x; ix<end_x; ++ix)
+	// every shade past the last table turns all colors black
+	const Uint8 *table;
+	Uint8 recolor[256];
+	if (!newBaseColor && off >= 0)
+	{
+		table = getShadeTable(std::min(off, SHADE_LEVELS - 1));
+	}
+	else
+	{
+		buildShadeTable(recolor, off, newBaseColor);
+		table = recolor;
+	}
+
+	if (!_spansValid)
+		buildSpans();
+
+	// skip the transparent rows above and below the sprite
+	const int first_y = std::max(start_y, _opaqueTop);
+	const int last_y = std::min(end_y, _opaqueBottom);
+
+	int dest_y = (y + first_y) * dpitch + x;
+	int src_y = first_y * spitch;
+	for(int iy = first_y; iy < last_y; ++iy, dest_y += dpitch, src_y += spitch)
+	{
+		const Uint16 *span = &_spans[_spanRows[iy]];
+		for (int n = *span++; n > 0; --n, span += 2)
 		{
-			int pixel = src[src_y + ix];
-			if(pixel)
+			const int span_start = std::max((int)span[0], start_x);
+			const int span_end = std::min(span[0] + span[1], end_x);
+			for(int ix = span_start; ix < span_end; ++ix)
 			{
-				if (newBaseColor)
-					baseColor = newBaseColor - 1;
-				else
-					baseColor = pixel>>4;
-
-				int newShade = (pixel&15) + off;
-				if (newShade > 15)
-				{
-					// so dark it would flip over to another color - make it black instead
-					baseColor = 0;
-					newShade = 15;
-				}
-				dest[dest_y + ix] = (baseColor<<4) | newShade;
+				dest[dest_y + ix] = table[src[src_y + ix]];
 			}
 		}
+	}
+	surface->_spansValid = false;
 }
 
 /**
@@ -21,6 +21,7 @@
 
 #include "SDL.h"
 #include <string>
+#include <vector>
 
 namespace OpenXcom
 {
@@ -40,9 +41,17 @@ protected:
 	SDL_Rect _crop;
 	bool _visible, _hidden, _redraw;
 	SDL_Color *_originalColors;
+	std::vector<Uint16> _spans;
+	std::vector<int> _spanRows;
+	bool _spansValid;
+	int _opaqueTop, _opaqueBottom;
+	/// Encodes the runs of non-transparent pixels of every row.
+	void buildSpans();
 public:
 	/// Creates a new surface with the specified size and position.
 	Surface(int width, int height, int x = 0, int y = 0);
+	/// Creates a new surface on top of existing pixels.
+	Surface(Uint8 *pixels, int width, int height, int pitch);
 	/// Creates a new surface from an existing one.
 	Surface(const Surface& other);
 	/// Cleans up the surface.
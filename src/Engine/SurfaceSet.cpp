@@ -18,8 +18,11 @@
  */
 #include "SurfaceSet.h"
 #include <fstream>
+#include <cstring>
+#include <algorithm>
 #include "Surface.h"
 #include "Exception.h"
+#include "AssetCache.h"
 
 namespace OpenXcom
 {
@@ -29,23 +32,29 @@ namespace OpenXcom
  * @param width Frame width in pixels.
  * @param height Frame height in pixels.
  */
-SurfaceSet::SurfaceSet(int width, int height) : _width(width), _height(height), _frames()
+SurfaceSet::SurfaceSet(int width, int height) : _width(width), _height(height), _pitch((width + 3) & ~3), _atlas(), _frames(), _palette(0), _paletteFirst(256), _paletteEnd(0), _framePalette()
 {
-
+	_sharedPalette.ncolors = 256;
+	_sharedPalette.colors = _colors;
 }
 
 /**
  * Performs a deep copy of an existing surface set.
  * @param other Surface set to copy from.
  */
-SurfaceSet::SurfaceSet(const SurfaceSet& other)
+SurfaceSet::SurfaceSet(const SurfaceSet& other) : _width(other._width), _height(other._height), _pitch(other._pitch), _atlas(), _frames(), _palette(0), _paletteFirst(256), _paletteEnd(0), _framePalette()
 {
-	_width = other._width;
-	_height = other._height;
-
-	for (unsigned int f = 0; f < other._frames.size(); f++)
+	_sharedPalette.ncolors = 256;
+	_sharedPalette.colors = _colors;
+	if (!other._frames.empty())
+	{
+		Uint8 *pixels = (Uint8*)other._frames.front()->getSurface()->pixels;
+		_atlas.assign(pixels, pixels + _pitch * _height * other._frames.size());
+		createFrames(&_atlas[0], other._frames.size());
+	}
+	if (other._paletteEnd > other._paletteFirst)
 	{
-		_frames.push_back(new Surface(*other._frames[f]));
+		setPalette(const_cast<SDL_Color*>(other._colors) + other._paletteFirst, other._paletteFirst, other._paletteEnd - other._paletteFirst);
 	}
 }
 
@@ -56,15 +65,46 @@ SurfaceSet::~SurfaceSet()
 {
 	for (std::vector<Surface*>::iterator i = _frames.begin(); i != _frames.end(); ++i)
 	{
+		// the palette is ours, don't let SDL free it
+		(*i)->getSurface()->format->palette = 0;
 		delete *i;
 	}
 }
 
+/**
+ * Creates the frames of the set on top of a block of
+ * pixels, each frame right after the previous one.
+ * SDL gives every frame a palette of its own, which is
+ * freed right away so the frame uses the set's instead.
+ * @param pixels Pointer to the block, which must outlive the set.
+ * @param count Number of frames in the block.
+ */
+void SurfaceSet::createFrames(Uint8 *pixels, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		Surface *frame = new Surface(pixels + i * _pitch * _height, _width, _height, _pitch);
+		SDL_PixelFormat *format = frame->getSurface()->format;
+		if (_frames.empty() && _paletteEnd <= _paletteFirst)
+		{
+			// no colors set yet, start with the SDL default
+			memcpy(_colors, format->palette->colors, sizeof(_colors));
+		}
+		SDL_free(format->palette->colors);
+		SDL_free(format->palette);
+		format->palette = &_sharedPalette;
+		_frames.push_back(frame);
+	}
+	// frames created after the colors were set still need their blits redone
+	_framePalette.resize(_frames.size(), (_paletteEnd > _paletteFirst) ? _palette - 1 : _palette);
+}
+
 /**
  * Loads the contents of an X-Com set of PCK/TAB image files
  * into the surface. The PCK file contains an RLE compressed
  * image, while the TAB file contains the offsets to each
- * frame in the image.
+ * frame in the image. Decoded frames are kept in the asset
+ * cache, so later runs can skip the decoding.
  * @param pck Filename of the PCK image.
  * @param tab Filename of the TAB offsets.
  * @sa http://www.ufopaedia.org/index.php?title=Image_Formats#PCK
@@ -72,25 +112,23 @@ SurfaceSet::~SurfaceSet()
 void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 {
 	int nframes = 0;
+	Uint8 *cached = AssetCache::loadPck(pck, tab, _width, _height, _pitch, &nframes);
+	if (cached != 0)
+	{
+		createFrames(cached, nframes);
+		return;
+	}
 
 	// Load TAB and get image offsets
 	std::ifstream offsetFile (tab.c_str(), std::ios::in | std::ios::binary);
 	if (!offsetFile)
 	{
 		nframes = 1;
-		Surface *surface = new Surface(_width, _height);
-		_frames.push_back(surface);
 	}
 	else
 	{
-		Uint16 off;
-
-		while (offsetFile.read((char*)&off, sizeof(off)))
-		{
-			Surface *surface = new Surface(_width, _height);
-			_frames.push_back(surface);
-			nframes++;
-		}
+		offsetFile.seekg(0, std::ios::end);
+		nframes = (int)offsetFile.tellg() / sizeof(Uint16);
 	}
 
 	// Load PCX and put pixels in surfaces
@@ -100,46 +138,48 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 		throw Exception("Failed to load PCK");
 	}
 
-	Uint8 value;
-
-	for (int frame = 0; frame < nframes; frame++)
+	imgFile.seekg(0, std::ios::end);
+	std::vector<Uint8> data((size_t)imgFile.tellg());
+	imgFile.seekg(0, std::ios::beg);
+	if (!data.empty())
 	{
-		int x = 0, y = 0;
+		imgFile.read((char*)&data[0], data.size());
+	}
 
-		// Lock the surface
-		_frames[frame]->lock();
+	_atlas.assign(_pitch * _height * nframes, 0);
+	size_t in = 0;
 
-		imgFile.read((char*)&value, 1);
-		for (int i = 0; i < value; ++i)
-		{
-			for (int j = 0; j < _width; ++j)
-			{
-				_frames[frame]->setPixelIterative(&x, &y, 0);
-			}
-		}
+	for (int frame = 0; frame < nframes && in < data.size(); frame++)
+	{
+		Uint8 *pixels = &_atlas[frame * _pitch * _height];
+		int pos = data[in++] * _width, end = _width * _height;
 
-		while (imgFile.read((char*)&value, 1) && value != 255)
+		while (in < data.size() && data[in] != 255)
 		{
+			Uint8 value = data[in++];
 			if (value == 254)
 			{
-				imgFile.read((char*)&value, 1);
-				for (int i = 0; i < value; ++i)
-				{
-					_frames[frame]->setPixelIterative(&x, &y, 0);
-				}
+				if (in < data.size())
+					pos += data[in++];
 			}
 			else
 			{
-				_frames[frame]->setPixelIterative(&x, &y, value);
+				if (pos < end)
+					pixels[(pos / _width) * _pitch + pos % _width] = value;
+				pos++;
 			}
 		}
-
-		// Unlock the surface
-		_frames[frame]->unlock();
+		in++;
 	}
 
 	imgFile.close();
 	offsetFile.close();
+
+	if (nframes > 0)
+	{
+		createFrames(&_atlas[0], nframes);
+		AssetCache::storePck(pck, tab, &_atlas[0], _width, _height, _pitch, nframes);
+	}
 }
 
 /**
@@ -166,40 +206,21 @@ void SurfaceSet::loadDat(const std::string &filename)
 	imgFile.seekg(0, std::ios::beg);
 
 	nframes = (int)size / (_width * _height);
-
-	for (int i = 0; i < nframes; ++i)
+	if (nframes == 0)
 	{
-		Surface *surface = new Surface(_width, _height);
-		_frames.push_back(surface);
+		return;
 	}
 
-	Uint8 value;
-	int x = 0, y = 0, frame = 0;
-
-	// Lock the surface
-	_frames[frame]->lock();
-
-	while (imgFile.read((char*)&value, 1))
+	// Frame rows are padded to the pitch, so read them one at a time
+	_atlas.assign(_pitch * _height * nframes, 0);
+	for (int y = 0; y < _height * nframes; ++y)
 	{
-		_frames[frame]->setPixelIterative(&x, &y, value);
-
-		if (y >= _height)
-		{
-			// Unlock the surface
-			_frames[frame]->unlock();
-
-			frame++;
-			x = 0;
-			y = 0;
-
-			if (frame >= nframes)
-				break;
-			else
-				_frames[frame]->lock();
-		}
+		imgFile.read((char*)&_atlas[y * _pitch], _width);
 	}
 
 	imgFile.close();
+
+	createFrames(&_atlas[0], nframes);
 }
 
 /**
@@ -209,6 +230,13 @@ void SurfaceSet::loadDat(const std::string &filename)
  */
 Surface *const SurfaceSet::getFrame(int i) const
 {
+	// the frame already has the set's colors, but SDL only
+	// redoes its blits after being told the palette changed
+	if (_framePalette[i] != _palette)
+	{
+		_frames[i]->setPalette(const_cast<SDL_Color*>(_colors) + _paletteFirst, _paletteFirst, _paletteEnd - _paletteFirst);
+		_framePalette[i] = _palette;
+	}
 	return _frames[i];
 }
 
@@ -242,16 +270,19 @@ int SurfaceSet::getTotalFrames() const
 
 /**
  * Replaces a certain amount of colors in all of the frames.
+ * The frames share the colors, but are only told about
+ * the change the next time they're used, so sets with lots
+ * of frames change quickly.
  * @param colors Pointer to the set of colors.
  * @param firstcolor Offset of the first color to replace.
  * @param ncolors Amount of colors to replace.
  */
 void SurfaceSet::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
-	for (std::vector<Surface*>::iterator i = _frames.begin(); i != _frames.end(); ++i)
-	{
-		(*i)->setPalette(colors, firstcolor, ncolors);
-	}
+	memcpy(_colors + firstcolor, colors, ncolors * sizeof(SDL_Color));
+	_paletteFirst = std::min(_paletteFirst, firstcolor);
+	_paletteEnd = std::max(_paletteEnd, firstcolor + ncolors);
+	_palette++;
 }
 
 }
@@ -33,12 +33,23 @@ class Surface;
  * Used to manage single images that contain series of
  * frames inside, like animated sprites, making them easier
  * to access without constant cropping.
+ * The pixels of all the frames are kept in one block, one
+ * frame after another, and each frame is a surface on top
+ * of its part of the block. All the frames share the set's
+ * palette instead of keeping a copy each.
  */
 class SurfaceSet
 {
 private:
-	int _width, _height;
+	int _width, _height, _pitch;
+	std::vector<Uint8> _atlas;
 	std::vector<Surface*> _frames;
+	SDL_Color _colors[256];
+	SDL_Palette _sharedPalette;
+	int _palette, _paletteFirst, _paletteEnd;
+	mutable std::vector<int> _framePalette;
+	/// Creates the frames on top of a block of pixels.
+	void createFrames(Uint8 *pixels, int count);
 public:
 	/// Crates a surface set with frames of the specified size.
 	SurfaceSet(int width, int height);
@@ -17,10 +17,14 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "Timer.h"
+#include <algorithm>
 
 namespace OpenXcom
 {
 
+bool Timer::_fired = false;
+Uint32 Timer::_deadline = 0xFFFFFFFF;
+
 /**
  * Initializes a new timer with a set interval.
  * @param interval Time interval in miliseconds.
@@ -43,6 +47,7 @@ void Timer::start()
 {
 	_start = SDL_GetTicks();
 	_running = true;
+	schedule();
 }
 
 /**
@@ -97,7 +102,22 @@ void Timer::think(State* state, Surface* surface)
 				(surface->*_surface)();
 			}
 			_start = SDL_GetTicks();
+			_fired = true;
 		}
+		schedule();
+	}
+}
+
+/**
+ * Keeps track of the earliest time any running
+ * timer goes off, so the game knows how long it
+ * can sleep for.
+ */
+void Timer::schedule()
+{
+	if (_running)
+	{
+		_deadline = std::min(_deadline, _start + _interval);
 	}
 }
 
@@ -128,4 +148,34 @@ void Timer::onTimer(SurfaceHandler handler)
 	_surface = handler;
 }
 
+/**
+ * Clears the record of timers that went off and
+ * the next deadline, at the start of every cycle.
+ */
+void Timer::resetActivity()
+{
+	_fired = false;
+	_deadline = 0xFFFFFFFF;
+}
+
+/**
+ * Returns if any timer went off since the last reset,
+ * meaning something probably changed on screen.
+ * @return True if a timer went off.
+ */
+bool Timer::hasFired()
+{
+	return _fired;
+}
+
+/**
+ * Returns the earliest time a timer that ran since the
+ * last reset will go off again.
+ * @return Time in miliseconds, as given by SDL_GetTicks.
+ */
+Uint32 Timer::getNextDeadline()
+{
+	return _deadline;
+}
+
 }
@@ -41,6 +41,10 @@ private:
 	bool _running;
 	StateHandler _state;
 	SurfaceHandler _surface;
+	static bool _fired;
+	static Uint32 _deadline;
+	/// Records when the timer goes off next.
+	void schedule();
 public:
 	/// Creates a stopped timer.
 	Timer(Uint32 interval);
@@ -62,6 +66,12 @@ public:
 	void onTimer(StateHandler handler);
 	/// Hooks a surface action handler to the timer interval.
 	void onTimer(SurfaceHandler handler);
+	/// Forgets what the timers have done so far.
+	static void resetActivity();
+	/// Checks if any timer went off.
+	static bool hasFired();
+	/// Gets when the next running timer goes off.
+	static Uint32 getNextDeadline();
 };
 
 }
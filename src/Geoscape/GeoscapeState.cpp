@@ -19,6 +19,7 @@
 #define _USE_MATH_DEFINES
 #include "GeoscapeState.h"
 #include <cmath>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include "../Engine/RNG.h"
@@ -396,6 +397,14 @@ void GeoscapeState::timeAdvance()
 
 	for (int i = 0; i < timeSpan && !_pause; ++i)
 	{
+		// Jump straight to the next tick where something can happen
+		int quiet = std::min(timeSpan - i - 1, getQuietTicks());
+		if (quiet > 0)
+		{
+			timeSkip(quiet);
+			i += quiet;
+		}
+
 		TimeTrigger trigger;
 		trigger = _game->getSavedGame()->getTime()->advance();
 		switch (trigger)
@@ -421,6 +430,80 @@ void GeoscapeState::timeAdvance()
 	_globe->drawRefresh();
 }
 
+/**
+ * Works out how many 5-second ticks can pass with nothing
+ * but UFOs and crafts moving in a straight line, before the next
+ * 10-minute trigger or something arriving at its destination.
+ * @return Number of ticks, 0 if the next tick has to be run in full.
+ */
+int GeoscapeState::getQuietTicks()
+{
+	GameTime *time = _game->getSavedGame()->getTime();
+	int ticks = (9 - time->getMinute() % 10) * 12 + (59 - time->getSecond()) / 5;
+
+	for (std::vector<Ufo*>::iterator i = _game->getSavedGame()->getUfos()->begin(); i != _game->getSavedGame()->getUfos()->end(); ++i)
+	{
+		if ((*i)->reachedDestination() || (*i)->getHoursCrashed() == 0)
+		{
+			return 0;
+		}
+		if (!(*i)->isCrashed())
+		{
+			ticks = std::min(ticks, (*i)->getQuietSteps());
+		}
+	}
+
+	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
+	{
+		for (std::vector<Craft*>::iterator j = (*i)->getCrafts()->begin(); j != (*i)->getCrafts()->end(); ++j)
+		{
+			if ((*j)->getDestination() == 0)
+			{
+				continue;
+			}
+			// Chasing a UFO changes course every tick
+			Ufo* u = dynamic_cast<Ufo*>((*j)->getDestination());
+			if ((*j)->reachedDestination() || (u != 0 && (!u->getDetected() || !u->isCrashed())))
+			{
+				return 0;
+			}
+			ticks = std::min(ticks, (*j)->getQuietSteps());
+		}
+	}
+
+	return std::max(ticks, 0);
+}
+
+/**
+ * Advances the game time by a number of 5-second ticks
+ * at once, moving every UFO and craft in one go.
+ * Only valid for as many ticks as getQuietTicks() allows.
+ * @param ticks Number of ticks.
+ */
+void GeoscapeState::timeSkip(int ticks)
+{
+	for (int i = 0; i < ticks; ++i)
+	{
+		_game->getSavedGame()->getTime()->advance();
+	}
+
+	for (std::vector<Ufo*>::iterator i = _game->getSavedGame()->getUfos()->begin(); i != _game->getSavedGame()->getUfos()->end(); ++i)
+	{
+		if (!(*i)->isCrashed())
+		{
+			(*i)->move(ticks);
+		}
+	}
+
+	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
+	{
+		for (std::vector<Craft*>::iterator j = (*i)->getCrafts()->begin(); j != (*i)->getCrafts()->end(); ++j)
+		{
+			(*j)->move(ticks);
+		}
+	}
+}
+
 /**
  * Takes care of any game logic that has to
  * run every game second, like craft movement.
@@ -555,10 +638,10 @@ void GeoscapeState::time10Minutes()
 void GeoscapeState::time30Minutes()
 {
 	// Spawn UFOs
-	int chance = RNG::generate(1, 100);
+	int chance = RNG::generate(RNG::STREAM_GEOSCAPE, 1, 100);
 	if (chance <= 50)
 	{
-		int type = RNG::generate(1, 3);
+		int type = RNG::generate(RNG::STREAM_GEOSCAPE, 1, 3);
 		Ufo *u;
 		switch (type)
 		{
@@ -572,13 +655,13 @@ void GeoscapeState::time30Minutes()
 			u = new Ufo(_game->getRuleset()->getUfo("STR_LARGE_SCOUT"));
 			break;
 		}
-		u->setLongitude(RNG::generate(0.0, 2*M_PI));
-		u->setLatitude(RNG::generate(-M_PI_2, M_PI_2));
+		u->setLongitude(RNG::generate(RNG::STREAM_GEOSCAPE, 0.0, 2*M_PI));
+		u->setLatitude(RNG::generate(RNG::STREAM_GEOSCAPE, -M_PI_2, M_PI_2));
 		Waypoint *w = new Waypoint();
-		w->setLongitude(RNG::generate(0.0, 2*M_PI));
-		w->setLatitude(RNG::generate(-M_PI_2, M_PI_2));
+		w->setLongitude(RNG::generate(RNG::STREAM_GEOSCAPE, 0.0, 2*M_PI));
+		w->setLatitude(RNG::generate(RNG::STREAM_GEOSCAPE, -M_PI_2, M_PI_2));
 		u->setDestination(w);
-		u->setSpeed(RNG::generate(u->getRules()->getMaxSpeed() / 4, u->getRules()->getMaxSpeed() / 2));
+		u->setSpeed(RNG::generate(RNG::STREAM_GEOSCAPE, u->getRules()->getMaxSpeed() / 4, u->getRules()->getMaxSpeed() / 2));
 		_game->getSavedGame()->getUfos()->push_back(u);
 	}
 
@@ -610,7 +693,7 @@ void GeoscapeState::time30Minutes()
 						continue;
 					if ((*f)->insideRadarRange(*u))
 					{
-						int chance = RNG::generate(1, 100);
+						int chance = RNG::generate(RNG::STREAM_GEOSCAPE, 1, 100);
 						if (chance <= (*f)->getRules()->getRadarChance())
 						{
 							detected = true;
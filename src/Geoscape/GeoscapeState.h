@@ -62,6 +62,10 @@ public:
 	void timeDisplay();
 	/// Advances the game timer.
 	void timeAdvance();
+	/// Gets how many 5-second ticks can pass before something happens.
+	int getQuietTicks();
+	/// Skips over ticks where only movement happens.
+	void timeSkip(int ticks);
 	/// Trigger whenever 5 seconds pass.
 	void time5Seconds();
 	/// Trigger whenever 10 minutes pass.
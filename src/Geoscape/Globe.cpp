@@ -19,6 +19,7 @@
 #define _USE_MATH_DEFINES
 #include "Globe.h"
 #include <cmath>
+#include <algorithm>
 #include <fstream>
 #include "../Engine/Action.h"
 #include "../Engine/SurfaceSet.h"
@@ -580,6 +581,57 @@ std::vector<Target*> Globe::getTargets(int x, int y, bool craft) const
 	return v;
 }
 
+/**
+ * Converts a polar point into a unit vector pointing
+ * from the center of the globe to that point.
+ * @param lon Longitude of the polar point.
+ * @param lat Latitude of the polar point.
+ * @param v Pointer to the output vector (3 values).
+ */
+static void polarToVector(double lon, double lat, double *v)
+{
+	v[0] = cos(lat) * sin(lon);
+	v[1] = sin(lat);
+	v[2] = cos(lat) * cos(lon);
+}
+
+/**
+ * Calculates the matrix that rotates the globe's unit vectors
+ * so the current center faces the viewer. The rows give the
+ * screen X, the screen Y and the depth of a point, so only one
+ * set of trigonometric functions is needed per globe movement.
+ */
+void Globe::calculateRotation()
+{
+	double sinLon = sin(_cenLon), cosLon = cos(_cenLon);
+	double sinLat = sin(_cenLat), cosLat = cos(_cenLat);
+
+	_rotation[0] = cosLon;
+	_rotation[1] = 0.0;
+	_rotation[2] = -sinLon;
+	_rotation[3] = -sinLat * sinLon;
+	_rotation[4] = cosLat;
+	_rotation[5] = -sinLat * cosLon;
+	_rotation[6] = cosLat * sinLon;
+	_rotation[7] = sinLat;
+	_rotation[8] = cosLat * cosLon;
+}
+
+/**
+ * Converts a unit vector into a cartesian point, same as
+ * polarToCart but using the cached rotation matrix.
+ * @param v Pointer to the vector (3 values).
+ * @param x Pointer to the output X position.
+ * @param y Pointer to the output Y position.
+ * @return Depth of the point, negative if it's on the back of the globe.
+ */
+double Globe::projectVector(const double *v, Sint16 *x, Sint16 *y) const
+{
+	*x = _cenX + (Sint16)floor(_radius[_zoom] * (_rotation[0] * v[0] + _rotation[2] * v[2]));
+	*y = _cenY + (Sint16)floor(_radius[_zoom] * (_rotation[3] * v[0] + _rotation[4] * v[1] + _rotation[5] * v[2]));
+	return _rotation[6] * v[0] + _rotation[7] * v[1] + _rotation[8] * v[2];
+}
+
 /**
  * Takes care of pre-calculating all the polygons currently visible
  * on the globe and caching them so they only need to be recalculated
@@ -587,12 +639,15 @@ std::vector<Target*> Globe::getTargets(int x, int y, bool craft) const
  */
 void Globe::cachePolygons()
 {
+	calculateRotation();
 	cache(_game->getResourcePack()->getPolygons(), &_cacheLand);
 	_redraw = true;
 }
 
 /**
- * Caches a set of polygons.
+ * Caches a set of polygons. The polygons' points are converted
+ * to unit vectors the first time, along with a bounding cone
+ * for each polygon, so whole polygons can be culled at once.
  * @param polygons Pointer to list of polygons.
  * @param cache Pointer to cache.
  */
@@ -605,17 +660,61 @@ void Globe::cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache)
 	}
 	cache->clear();
 
+	if (_landVectors.empty())
+	{
+		for (std::list<Polygon*>::iterator i = polygons->begin(); i != polygons->end(); ++i)
+		{
+			double center[3] = {0.0, 0.0, 0.0};
+			size_t first = _landVectors.size();
+			for (int j = 0; j < (*i)->getPoints(); ++j)
+			{
+				double v[3];
+				polarToVector((*i)->getLongitude(j), (*i)->getLatitude(j), v);
+				for (int k = 0; k < 3; ++k)
+				{
+					_landVectors.push_back(v[k]);
+					center[k] += v[k];
+				}
+			}
+			double length = sqrt(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]);
+			for (int k = 0; k < 3; ++k)
+			{
+				center[k] /= length;
+			}
+			// Sine of the widest angle between the center and a point
+			double minCos = 1.0;
+			for (size_t j = first; j < _landVectors.size(); j += 3)
+			{
+				minCos = std::min(minCos, center[0] * _landVectors[j] + center[1] * _landVectors[j + 1] + center[2] * _landVectors[j + 2]);
+			}
+			_landBounds.push_back(center[0]);
+			_landBounds.push_back(center[1]);
+			_landBounds.push_back(center[2]);
+			_landBounds.push_back(minCos < 0.0 ? 1.0 : sqrt(1.0 - minCos * minCos));
+		}
+	}
+
+	if (_landVectors.empty())
+		return;
+
 	// Pre-calculate values to cache
-	for (std::list<Polygon*>::iterator i = polygons->begin(); i != polygons->end(); ++i)
+	const double *v = &_landVectors[0], *bounds = &_landBounds[0];
+	for (std::list<Polygon*>::iterator i = polygons->begin(); i != polygons->end(); v += 3 * (*i)->getPoints(), bounds += 4, ++i)
 	{
 		// Is quad on the back face?
-		bool backFace = true;
-		for (int j = 0; j < (*i)->getPoints(); ++j)
+		double depth = _rotation[6] * bounds[0] + _rotation[7] * bounds[1] + _rotation[8] * bounds[2];
+		if (depth < -bounds[3])
+			continue;
+		if (depth <= bounds[3])
 		{
-			backFace = backFace && pointBack((*i)->getLongitude(j), (*i)->getLatitude(j));
+			bool backFace = true;
+			for (int j = 0; j < (*i)->getPoints() && backFace; ++j)
+			{
+				backFace = _rotation[6] * v[3 * j] + _rotation[7] * v[3 * j + 1] + _rotation[8] * v[3 * j + 2] < 0;
+			}
+			if (backFace)
+				continue;
 		}
-		if (backFace)
-			continue;
 
 		Polygon* p = new Polygon(**i);
 
@@ -623,7 +722,7 @@ void Globe::cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache)
 		for (int j = 0; j < p->getPoints(); ++j)
 		{
 			Sint16 x, y;
-			polarToCart(p->getLongitude(j), p->getLatitude(j), &x, &y);
+			projectVector(v + 3 * j, &x, &y);
 			p->setX(j, x);
 			p->setY(j, y);
 		}
@@ -1036,19 +1135,41 @@ void Globe::drawDetail()
 		// Lock the surface
 		_countries->lock();
 
-		for (std::list<Polyline*>::iterator i = _game->getResourcePack()->getPolylines()->begin(); i != _game->getResourcePack()->getPolylines()->end(); ++i)
+		std::list<Polyline*> *polylines = _game->getResourcePack()->getPolylines();
+		if (_borderVectors.empty())
 		{
+			for (std::list<Polyline*>::iterator i = polylines->begin(); i != polylines->end(); ++i)
+			{
+				for (int j = 0; j < (*i)->getPoints(); ++j)
+				{
+					double v[3];
+					polarToVector((*i)->getLongitude(j), (*i)->getLatitude(j), v);
+					_borderVectors.insert(_borderVectors.end(), v, v + 3);
+				}
+			}
+		}
+
+		const double *v = _borderVectors.empty() ? 0 : &_borderVectors[0];
+		for (std::list<Polyline*>::iterator i = polylines->begin(); i != polylines->end(); v += 3 * (*i)->getPoints(), ++i)
+		{
+			if ((*i)->getPoints() == 0)
+				continue;
+
+			// Convert coordinates, each point only once
 			Sint16 x[2], y[2];
+			bool back[2];
+			back[1] = projectVector(v, &x[1], &y[1]) < 0;
 			for (int j = 0; j < (*i)->getPoints() - 1; ++j)
 			{
+				x[0] = x[1];
+				y[0] = y[1];
+				back[0] = back[1];
+				back[1] = projectVector(v + 3 * (j + 1), &x[1], &y[1]) < 0;
+
 				// Don't draw if polyline is facing back
-				if (pointBack((*i)->getLongitude(j), (*i)->getLatitude(j)) || pointBack((*i)->getLongitude(j + 1), (*i)->getLatitude(j + 1)))
+				if (back[0] || back[1])
 					continue;
 
-				// Convert coordinates
-				polarToCart((*i)->getLongitude(j), (*i)->getLatitude(j), &x[0], &y[0]);
-				polarToCart((*i)->getLongitude(j + 1), (*i)->getLatitude(j + 1), &x[1], &y[1]);
-
 				_countries->drawLine(x[0], y[0], x[1], y[1], Palette::blockOffset(10)+2);
 			}
 		}
@@ -61,6 +61,8 @@ private:
 	bool _blink, _detail;
 	Timer *_blinkTimer, *_rotTimer;
 	std::list<Polygon*> _cacheLand;
+	double _rotation[9];
+	std::vector<double> _landVectors, _landBounds, _borderVectors;
 	Surface *_mkXcomBase, *_mkAlienBase, *_mkCraft, *_mkWaypoint, *_mkCity;
 	Surface *_mkFlyingUfo, *_mkLandedUfo, *_mkCrashedUfo, *_mkAlienSite;
 
@@ -74,6 +76,10 @@ private:
 	bool targetNear(Target* target, int x, int y) const;
 	/// Caches a set of polygons.
 	void cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache);
+	/// Calculates the rotation matrix of the current globe center.
+	void calculateRotation();
+	/// Converts a unit vector to cartesian coordinates.
+	double projectVector(const double *v, Sint16 *x, Sint16 *y) const;
 	/// Fills the ocean longitude segments.
 	void fillLongitudeSegments(double startLon, double endLon, int colourShift);
 	/// Gets the shade of a land polygon.
@@ -19,11 +19,15 @@
 
 #include "FpsCounter.h"
 #include <cmath>
+#include <algorithm>
+#include <cstring>
 #include "../Engine/Palette.h"
 #include "../Engine/Action.h"
 #include "../Engine/Timer.h"
 #include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
 #include "NumberText.h"
+#include "Text.h"
 
 namespace OpenXcom
 {
@@ -37,13 +41,21 @@ namespace OpenXcom
  */
 FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, height, x, y), _frames(0)
 {
-	_visible = Options::getBool("fpsCounter");
+	_visible = Options::getBool("fpsCounter") || Profiler::isEnabled();
 
 	_timer = new Timer(1000);
 	_timer->onTimer((SurfaceHandler)&FpsCounter::update);
 	_timer->start();
 
-	_text = new NumberText(width, height, x, y);
+	_text = new NumberText(15, 5, 0, 0);
+	_zoneText = new NumberText(24, 5, 0, 0);
+	for (int zone = 0; zone < Profiler::ZONE_TOTAL; ++zone)
+	{
+		const char *name = Profiler::getName((Profiler::Zone)zone);
+		Text *text = new Text(width - Profiler::HISTORY - 32, ROW_HEIGHT, Profiler::HISTORY + 32, 7 + zone * ROW_HEIGHT);
+		text->setText(std::wstring(name, name + strlen(name)));
+		_zoneNames.push_back(text);
+	}
 	setColor(Palette::blockOffset(15)+12);
 }
 
@@ -53,9 +65,29 @@ FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, hei
 FpsCounter::~FpsCounter()
 {
 	delete _text;
+	delete _zoneText;
+	for (std::vector<Text*>::iterator i = _zoneNames.begin(); i != _zoneNames.end(); ++i)
+	{
+		delete *i;
+	}
 	delete _timer;
 }
 
+/**
+ * Changes the fonts used for the zone names. Until
+ * they're set the zones are shown without names.
+ * @param big Pointer to large-size font.
+ * @param small Pointer to small-size font.
+ */
+void FpsCounter::setFonts(Font *big, Font *small)
+{
+	for (std::vector<Text*>::iterator i = _zoneNames.begin(); i != _zoneNames.end(); ++i)
+	{
+		(*i)->setFonts(big, small);
+	}
+	_redraw = true;
+}
+
 /**
  * Replaces a certain amount of colors in the FPS counter palette.
  * @param colors Pointer to the set of colors.
@@ -66,6 +98,11 @@ void FpsCounter::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
 	Surface::setPalette(colors, firstcolor, ncolors);
 	_text->setPalette(colors, firstcolor, ncolors);
+	_zoneText->setPalette(colors, firstcolor, ncolors);
+	for (std::vector<Text*>::iterator i = _zoneNames.begin(); i != _zoneNames.end(); ++i)
+	{
+		(*i)->setPalette(colors, firstcolor, ncolors);
+	}
 }
 
 /**
@@ -75,30 +112,50 @@ void FpsCounter::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 void FpsCounter::setColor(Uint8 color)
 {
 	_text->setColor(color);
+	_zoneText->setColor(color);
+	for (std::vector<Text*>::iterator i = _zoneNames.begin(); i != _zoneNames.end(); ++i)
+	{
+		(*i)->setColor(color);
+	}
 }
 
 /**
- * Shows / hides the FPS counter.
+ * Shows / hides the FPS counter with F5,
+ * and turns the profiler on / off with F6.
  * @param action Pointer to an action.
  */
 void FpsCounter::handle(Action *action)
 {
 	if (action->getDetails()->type == SDL_KEYDOWN && action->getDetails()->key.keysym.sym == SDLK_F5)
 	{
-		_visible = !_visible;
-		Options::setBool("fpsCounter", _visible);
+		Options::setBool("fpsCounter", !Options::getBool("fpsCounter"));
+	}
+	else if (action->getDetails()->type == SDL_KEYDOWN && action->getDetails()->key.keysym.sym == SDLK_F6)
+	{
+		Profiler::setEnabled(!Profiler::isEnabled());
+		Options::setBool("profiler", Profiler::isEnabled());
+		_redraw = true;
 	}
+	_visible = Options::getBool("fpsCounter") || Profiler::isEnabled();
 }
 
 /**
- * Advances frame counter.
+ * Keeps the counter timer running.
  */
 void FpsCounter::think()
 {
-	_frames++;
 	_timer->think(0, this);
 }
 
+/**
+ * Advances frame counter. Only frames that were
+ * actually drawn count, not idle game cycles.
+ */
+void FpsCounter::addFrame()
+{
+	_frames++;
+}
+
 /**
  * Updates the amount of Frames per Second.
  */
@@ -117,6 +174,44 @@ void FpsCounter::draw()
 {
 	Surface::draw();
 	_text->blit(this);
+	if (Profiler::isEnabled())
+	{
+		drawProfiler();
+	}
+}
+
+/**
+ * Draws a row for each profiler zone under the counter,
+ * with a bar for each of the last frames, newest on the
+ * right, one pixel high for every 2ms spent in the zone,
+ * followed by the average time per frame in microseconds
+ * and the name of the zone.
+ */
+void FpsCounter::drawProfiler()
+{
+	for (int zone = 0; zone < Profiler::ZONE_TOTAL; ++zone)
+	{
+		int y = 7 + zone * ROW_HEIGHT;
+		for (int frame = 0; frame < Profiler::HISTORY; ++frame)
+		{
+			double time = Profiler::getTime((Profiler::Zone)zone, frame);
+			int height = std::min(ROW_HEIGHT - 1, (int)ceil(time / 2000.0));
+			if (height > 0)
+			{
+				SDL_Rect bar;
+				bar.x = Profiler::HISTORY - 1 - frame;
+				bar.y = y + ROW_HEIGHT - 1 - height;
+				bar.w = 1;
+				bar.h = height;
+				drawRect(&bar, _text->getColor());
+			}
+		}
+		_zoneText->setX(Profiler::HISTORY + 4);
+		_zoneText->setY(y + 2);
+		_zoneText->setValue((unsigned int)Profiler::getAverage((Profiler::Zone)zone));
+		_zoneText->blit(this);
+		_zoneNames[zone]->blit(this);
+	}
 }
 
 }
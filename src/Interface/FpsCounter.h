@@ -20,38 +20,52 @@
 #ifndef OPENXCOM_FPSCOUNTER_H
 #define OPENXCOM_FPSCOUNTER_H
 
+#include <vector>
 #include "../Engine/Surface.h"
 
 namespace OpenXcom
 {
 
 class NumberText;
+class Text;
+class Font;
 class Timer;
 class Action;
 
 /**
  * Counts the amount of frames each second
  * and displays them in a NumberText surface.
+ * When the profiler is on, it also shows the time
+ * spent in each profiler zone over the last frames,
+ * labeled with the zone names once the fonts are loaded.
  */
 class FpsCounter : public Surface
 {
 private:
-	NumberText *_text;
+	static const int ROW_HEIGHT = 9;
+	NumberText *_text, *_zoneText;
+	std::vector<Text*> _zoneNames;
 	Timer *_timer;
 	int _frames;
+	/// Draws the profiler zones.
+	void drawProfiler();
 public:
 	/// Creates a new FPS counter linked to a game.
 	FpsCounter(int width, int height, int x, int y);
 	/// Cleans up all the FPS counter resources.
 	~FpsCounter();
+	/// Sets the fonts for the zone names.
+	void setFonts(Font *big, Font *small);
 	/// Sets the FPS counter's palette.
 	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256);
 	/// Sets the FpsCounter's color.
 	void setColor(Uint8 color);
 	/// Handles keyboard events.
 	void handle(Action *action);
-	/// Advances frame counter.
+	/// Updates the FPS counter timer.
 	void think();
+	/// Counts a frame drawn on screen.
+	void addFrame();
 	// Updates FPS counter.
 	void update();
 	/// Draws the FPS counter.
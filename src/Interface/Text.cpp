@@ -18,6 +18,7 @@
  */
 #include "Text.h"
 #include <sstream>
+#include <algorithm>
 #include "../Engine/Font.h"
 
 namespace OpenXcom
@@ -30,7 +31,7 @@ namespace OpenXcom
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-Text::Text(int width, int height, int x, int y) : Surface(width, height, x, y), _big(0), _small(0), _font(0), _text(L""), _wrap(false), _invert(false), _contrast(false), _align(ALIGN_LEFT), _valign(ALIGN_TOP), _color(0), _color2(0)
+Text::Text(int width, int height, int x, int y) : Surface(width, height, x, y), _big(0), _small(0), _font(0), _text(L""), _wrap(false), _invert(false), _contrast(false), _align(ALIGN_LEFT), _valign(ALIGN_TOP), _color(0), _color2(0), _glyphs(), _layout(false)
 {
 }
 
@@ -121,10 +122,17 @@ void Text::setFonts(Font *big, Font *small)
 
 /**
  * Changes the string displayed on screen.
+ * Setting the same string again does nothing, so texts
+ * updated every tick don't get laid out and redrawn
+ * unless they actually change.
  * @param text Text string.
  */
 void Text::setText(const std::wstring &text)
 {
+	if (text == _text)
+	{
+		return;
+	}
 	_text = text;
 	processText();
 }
@@ -183,6 +191,7 @@ void Text::setHighContrast(bool contrast)
 void Text::setAlign(TextHAlign align)
 {
 	_align = align;
+	_layout = false;
 	_redraw = true;
 }
 
@@ -194,6 +203,7 @@ void Text::setAlign(TextHAlign align)
 void Text::setVerticalAlign(TextVAlign valign)
 {
 	_valign = valign;
+	_layout = false;
 	_redraw = true;
 }
 
@@ -319,14 +329,14 @@ void Text::processText()
 		else if (*c == L' ')
 		{
 			space = c;
-			width += font->getWidth() / 2;
+			width += font->getAdvance(*c);
 			word = 0;
 		}
 		// Keep track of the width of the last line and word
 		else if (*c != 1)
 		{
-			width += font->getChar(*c)->getCrop()->w + font->getSpacing();
-			word += font->getChar(*c)->getCrop()->w + font->getSpacing();
+			width += font->getAdvance(*c);
+			word += font->getAdvance(*c);
 
 			// Wordwrap if the last word doesn't fit the line
 			if (_wrap && width > getWidth())
@@ -339,24 +349,24 @@ void Text::processText()
 		}
 	}
 
+	_layout = false;
 	_redraw = true;
 }
 
 /**
- * Draws all the characters in the text with a really
- * nasty complex gritty text rendering algorithm logic stuff.
+ * Works out which glyph goes where for every character in
+ * the text, with the alignment and font changes applied, so
+ * drawing just has to copy them. Only redone when the text,
+ * its font or its alignment change.
  */
-void Text::draw()
+void Text::layout()
 {
-	Surface::draw();
-	if (_text.empty() || _font == 0)
-	{
-		return;
-	}
+	_glyphs.clear();
+	_layout = true;
 
 	int x = 0, y = 0, line = 0, height = 0;
 	Font *font = _font;
-	int color = _color;
+	bool secondary = false;
 	std::wstring *s = &_text;
 
 	for (std::vector<int>::iterator i = _lineHeight.begin(); i != _lineHeight.end(); ++i)
@@ -395,24 +405,11 @@ void Text::draw()
 		s = &_wrappedText;
 	}
 
-	// Set up text color
-	int mul = 1;
-	if (_contrast)
-	{
-		mul = 3;
-	}
-
-	// Invert text by inverting the font palette on index 3 (font palettes use indices 1-5)
-	int mid = _invert ? 3 : 0;
-
-	font->getSurface()->paletteShift(color, mul, mid);
-
-	// Draw each letter one by one
 	for (std::wstring::iterator c = s->begin(); c != s->end(); ++c)
 	{
 		if (*c == ' ')
 		{
-			x += font->getWidth() / 2;
+			x += font->getAdvance(*c);
 		}
 		else if (*c == '\n' || *c == 2)
 		{
@@ -432,29 +429,93 @@ void Text::draw()
 			}
 			if (*c == 2)
 			{
-				font->getSurface()->paletteRestore();
 				font = _small;
-				font->getSurface()->paletteShift(color, mul, mid);
 			}
 		}
 		else if (*c == 1)
 		{
-			font->getSurface()->paletteRestore();
-			color = (color == _color ? _color2 : _color);
-			font->getSurface()->paletteShift(color, mul, mid);
+			secondary = !secondary;
 		}
 		else
 		{
-			Surface* chr = font->getChar(*c);
-			chr->setX(x);
-			chr->setY(y);
-			chr->blit(this);
-			x += chr->getCrop()->w + font->getSpacing();
+			Glyph glyph;
+			glyph.font = font;
+			glyph.glyph = font->getGlyph(*c);
+			glyph.x = x;
+			glyph.y = y;
+			glyph.secondary = secondary;
+			_glyphs.push_back(glyph);
+			x += font->getAdvance(*c);
 		}
 	}
+}
 
-	// Revert text color
-	font->getSurface()->paletteRestore();
+/**
+ * Draws all the characters in the text by copying their pixels
+ * straight out of the font, recoloring them on the way.
+ * Fonts are greyscale, so each color is just a table from the
+ * font's pixel values to the palette, shifted the same way as
+ * Surface::paletteShift would do to the font itself.
+ */
+void Text::draw()
+{
+	Surface::draw();
+	if (_text.empty() || _font == 0)
+	{
+		return;
+	}
+
+	if (!_layout)
+	{
+		layout();
+	}
+
+	// Set up text color
+	int mul = 1;
+	if (_contrast)
+	{
+		mul = 3;
+	}
+
+	// Invert text by inverting the font palette on index 3 (font palettes use indices 1-5)
+	int mid = _invert ? 3 : 0;
+
+	Uint8 colors[2][256];
+	for (int i = 0; i < 256; ++i)
+	{
+		int inverseOffset = mid ? 2 * (mid - i) : 0;
+		colors[0][i] = (((i * mul + _color + inverseOffset) % 256) + 256) % 256;
+		colors[1][i] = (((i * mul + _color2 + inverseOffset) % 256) + 256) % 256;
+	}
+
+	SDL_Surface *dst = getSurface();
+	lock();
+	for (std::vector<Glyph>::const_iterator i = _glyphs.begin(); i != _glyphs.end(); ++i)
+	{
+		SDL_Surface *src = i->font->getSurface()->getSurface();
+		const SDL_Rect &rect = i->font->getGlyphRect(i->glyph);
+		const Uint8 *color = colors[i->secondary ? 1 : 0];
+
+		// Clip the glyph to both surfaces
+		int left = std::max(0, std::max(-i->x, -(int)rect.x));
+		int right = std::min((int)rect.w, std::min(dst->w - i->x, src->w - rect.x));
+		int top = std::max(0, -i->y);
+		int bottom = std::min((int)rect.h, std::min(dst->h - i->y, src->h - rect.y));
+
+		for (int y = top; y < bottom; ++y)
+		{
+			const Uint8 *from = (const Uint8*)src->pixels + (rect.y + y) * src->pitch + rect.x;
+			Uint8 *to = (Uint8*)dst->pixels + (i->y + y) * dst->pitch + i->x;
+			for (int x = left; x < right; ++x)
+			{
+				if (from[x] != 0)
+				{
+					to[x] = color[from[x]];
+				}
+			}
+		}
+	}
+	unlock();
 }
 
 }
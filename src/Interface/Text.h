@@ -40,6 +40,13 @@ enum TextVAlign { ALIGN_TOP, ALIGN_MIDDLE, ALIGN_BOTTOM };
 class Text : public Surface
 {
 private:
+	/// A character placed in the text, ready to be copied from its font.
+	struct Glyph
+	{
+		Font *font;
+		int glyph, x, y;
+		bool secondary;
+	};
 	Font *_big, *_small, *_font;
 	std::wstring _text, _wrappedText;
 	std::vector<int> _lineWidth, _lineHeight;
@@ -47,9 +54,13 @@ private:
 	TextHAlign _align;
 	TextVAlign _valign;
 	Uint8 _color, _color2;
+	std::vector<Glyph> _glyphs;
+	bool _layout;
 
 	/// Processes the contained text.
 	void processText();
+	/// Places each character of the text.
+	void layout();
 public:
 	/// Creates a new text with the specified size and position.
 	Text(int width, int height, int x = 0, int y = 0);
@@ -269,14 +269,7 @@ void TextEdit::draw()
 		int x = 0;
 		for (unsigned int i = 0; i < _caretPos; ++i)
 		{
-			if (_value[i] == ' ')
-			{
-				x += _text->getFont()->getWidth() / 2;
-			}
-			else
-			{
-				x += _text->getFont()->getChar(_value[i])->getCrop()->w + _text->getFont()->getSpacing();
-			}
+			x += _text->getFont()->getAdvance(_value[i]);
 		}
 		_caret->setX(x);
 		_caret->blit(this);
@@ -299,14 +292,7 @@ bool TextEdit::exceedsMaxWidth(wchar_t c)
 	s += c;
 	for (std::wstring::iterator i = s.begin(); i < s.end(); ++i)
 	{
-		if (*i == ' ')
-		{
-			w += _text->getFont()->getWidth() / 2;
-		}
-		else
-		{
-			w += _text->getFont()->getChar(*i)->getCrop()->w + _text->getFont()->getSpacing();
-		}
+		w += _text->getFont()->getAdvance(*i);
 	}
 
 	return (w > getWidth());
@@ -19,6 +19,7 @@
 #include "TextList.h"
 #include <cstdarg>
 #include <cmath>
+#include <algorithm>
 #include "../Engine/Action.h"
 #include "../Engine/Font.h"
 #include "../Engine/Palette.h"
@@ -27,6 +28,31 @@
 namespace OpenXcom
 {
 
+/**
+ * Works out how wide a string is when drawn in a certain font,
+ * the same way a Text would.
+ * @param font Pointer to the font.
+ * @param text Text string.
+ * @return Width in pixels of the widest line.
+ */
+static int textWidth(Font *font, const std::wstring &text)
+{
+	int width = 0, line = 0;
+	for (std::wstring::const_iterator c = text.begin(); c != text.end(); ++c)
+	{
+		if (*c == L'\n' || *c == 2)
+		{
+			line = 0;
+		}
+		else if (*c != 1)
+		{
+			line += font->getAdvance(*c);
+			width = std::max(width, line);
+		}
+	}
+	return width;
+}
+
 /**
  * Sets up a blank list with the specified size and position.
  * @param width Width in pixels.
@@ -34,7 +60,7 @@ namespace OpenXcom
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-TextList::TextList(int width, int height, int x, int y) : InteractiveSurface(width, height, x, y), _texts(), _columns(), _big(0), _small(0), _font(0), _scroll(0), _visibleRows(0), _color(0), _align(ALIGN_LEFT), _dot(false), _selectable(false), _condensed(false), _contrast(false),
+TextList::TextList(int width, int height, int x, int y) : InteractiveSurface(width, height, x, y), _rows(), _texts(), _columns(), _big(0), _small(0), _font(0), _scroll(0), _visibleRows(0), _color(0), _align(ALIGN_LEFT), _dot(false), _selectable(false), _condensed(false), _contrast(false),
 																								   _selRow(0), _bg(0), _selector(0), _margin(0), _arrowLeft(), _arrowRight(), _arrowPos(-1), _arrowType(ARROW_VERTICAL), _leftClick(0), _leftPress(0), _leftRelease(0), _rightClick(0), _rightPress(0), _rightRelease(0)
 {
 	_up = new ArrowButton(ARROW_BIG_UP, 13, 14, getX() + getWidth() + 4, getY() + 1);
@@ -50,21 +76,7 @@ TextList::TextList(int width, int height, int x, int y) : InteractiveSurface(wid
  */
 TextList::~TextList()
 {
-	for (std::vector< std::vector<Text*> >::iterator u = _texts.begin(); u < _texts.end(); ++u)
-	{
-		for (std::vector<Text*>::iterator v = (*u).begin(); v < (*u).end(); ++v)
-		{
-			delete *v;
-		}
-	}
-	for (std::vector<ArrowButton*>::iterator i = _arrowLeft.begin(); i < _arrowLeft.end(); ++i)
-	{
-		delete *i;
-	}
-	for (std::vector<ArrowButton*>::iterator i = _arrowRight.begin(); i < _arrowRight.end(); ++i)
-	{
-		delete *i;
-	}
+	deleteTexts();
 	delete _selector;
 	delete _up;
 	delete _down;
@@ -95,7 +107,8 @@ void TextList::unpress(State *state)
  */
 void TextList::setCellColor(int row, int column, Uint8 color)
 {
-	_texts[row][column]->setColor(color);
+	_rows[row][column].color = color;
+	_redraw = true;
 }
 
 /**
@@ -106,9 +119,9 @@ void TextList::setCellColor(int row, int column, Uint8 color)
  */
 void TextList::setRowColor(int row, Uint8 color)
 {
-	for (std::vector<Text*>::iterator i = _texts[row].begin(); i < _texts[row].end(); ++i)
+	for (std::vector<Cell>::iterator i = _rows[row].begin(); i < _rows[row].end(); ++i)
 	{
-		(*i)->setColor(color);
+		i->color = color;
 	}
 	_redraw = true;
 }
@@ -121,7 +134,7 @@ void TextList::setRowColor(int row, Uint8 color)
  */
 std::wstring TextList::getCellText(int row, int column) const
 {
-	return _texts[row][column]->getText();
+	return _rows[row][column].text;
 }
 
 /**
@@ -132,13 +145,13 @@ std::wstring TextList::getCellText(int row, int column) const
  */
 void TextList::setCellText(int row, int column, const std::wstring &text)
 {
-	_texts[row][column]->setText(text);
+	_rows[row][column].text = text;
 	_redraw = true;
 }
 
 /**
- * Adds a new row of text to the list, automatically creating
- * the required Text objects lined up where they need to be.
+ * Adds a new row of text to the list, working out
+ * where each cell needs to be lined up.
  * @param cols Number of columns.
  * @param ... Text for each cell in the new row.
  */
@@ -146,83 +159,38 @@ void TextList::addRow(int cols, ...)
 {
 	va_list args;
 	va_start(args, cols);
-	std::vector<Text*> temp;
+	std::vector<Cell> temp;
 	int rowX = 0;
 
 	for (int i = 0; i < cols; ++i)
 	{
-		// Place text
-		Text* txt = new Text(_columns[i], _font->getHeight(), _margin + rowX, getY());
-		txt->setPalette(this->getPalette());
-		txt->setFonts(_big, _small);
-		txt->setColor(_color);
-		txt->setSecondaryColor(_color2);
-		txt->setAlign(_align);
-		txt->setHighContrast(_contrast);
-		if (_font == _big)
-		{
-			txt->setBig();
-		}
-		else
-		{
-			txt->setSmall();
-		}
-		txt->setText(va_arg(args, wchar_t*));
+		Cell cell;
+		cell.text = va_arg(args, wchar_t*);
+		cell.x = _margin + rowX;
+		cell.color = _color;
+		int w = textWidth(_font, cell.text);
 
 		// Places dots between text
 		if (_dot && i < cols - 1)
 		{
-			std::wstring buf = txt->getText();
-			int w = txt->getTextWidth();
 			while (w < _columns[i])
 			{
-				w += _font->getChar('.')->getCrop()->w + _font->getSpacing();
-				buf += '.';
+				w += _font->getAdvance('.');
+				cell.text += '.';
 			}
-			txt->setText(buf);
 		}
 
-		temp.push_back(txt);
+		temp.push_back(cell);
 		if (_condensed)
 		{
-			rowX += txt->getTextWidth();
+			rowX += w;
 		}
 		else
 		{
 			rowX += _columns[i];
 		}
 	}
-	_texts.push_back(temp);
-
-	// Place arrow buttons
-	if (_arrowPos != -1)
-	{
-		ArrowShape shape1, shape2;
-		if (_arrowType == ARROW_VERTICAL)
-		{
-			shape1 = ARROW_SMALL_UP;
-			shape2 = ARROW_SMALL_DOWN;
-		}
-		else
-		{
-			shape1 = ARROW_SMALL_LEFT;
-			shape2 = ARROW_SMALL_RIGHT;
-		}
-		ArrowButton *a1 = new ArrowButton(shape1, 11, 8, getX() + _arrowPos, getY());
-		a1->setPalette(this->getPalette());
-		a1->setColor(_up->getColor());
-		a1->onMouseClick(_leftClick);
-		a1->onMousePress(_leftPress);
-		a1->onMouseRelease(_leftRelease);
-		_arrowLeft.push_back(a1);
-		ArrowButton *a2 = new ArrowButton(shape2, 11, 8, getX() + _arrowPos + 12, getY());
-		a2->setPalette(this->getPalette());
-		a2->setColor(_up->getColor());
-		a2->onMouseClick(_rightClick);
-		a2->onMousePress(_rightPress);
-		a2->onMouseRelease(_rightRelease);
-		_arrowRight.push_back(a2);
-	}
+	_rows.push_back(temp);
 
 	_redraw = true;
 	va_end(args);
@@ -247,6 +215,7 @@ void TextList::setColumns(int cols, ...)
 	}
 
 	va_end(args);
+	deleteTexts();
 }
 
 /**
@@ -294,15 +263,27 @@ void TextList::setFonts(Font *big, Font *small)
 	_small = small;
 	_font = small;
 
+	updateFont();
+}
+
+/**
+ * Recreates the selector and recounts how many rows fit
+ * in the list whenever the font changes.
+ */
+void TextList::updateFont()
+{
 	delete _selector;
 	_selector = new Surface(getWidth(), _font->getHeight() + _font->getSpacing(), getX(), getY());
 	_selector->setPalette(getPalette());
 	_selector->setVisible(false);
 
+	_visibleRows = 0;
 	for (int y = 0; y < getHeight(); y += _font->getHeight() + _font->getSpacing())
 	{
 		_visibleRows++;
 	}
+	deleteTexts();
+	updateArrows();
 }
 
 /**
@@ -333,6 +314,7 @@ Uint8 TextList::getColor() const
 void TextList::setSecondaryColor(Uint8 color)
 {
 	_color2 = color;
+	deleteTexts();
 }
 
 /**
@@ -352,16 +334,17 @@ Uint8 TextList::getSecondaryColor() const
 void TextList::setHighContrast(bool contrast)
 {
 	_contrast = contrast;
+	deleteTexts();
 }
 
 /**
- * Changes the horizontal alignment of the text in the list. This doesn't change
- * the alignment of existing text, just the alignment of text added from then on.
+ * Changes the horizontal alignment of the text in the list.
  * @param align Horizontal alignment.
  */
 void TextList::setAlign(TextHAlign align)
 {
 	_align = align;
+	deleteTexts();
 }
 
 /**
@@ -391,15 +374,7 @@ void TextList::setBig()
 {
 	_font = _big;
 
-	delete _selector;
-	_selector = new Surface(getWidth(), _font->getHeight() + _font->getSpacing(), getX(), getY());
-	_selector->setPalette(getPalette());
-	_selector->setVisible(false);
-
-	for (int y = 0; y < getHeight(); y += _font->getHeight() + _font->getSpacing())
-	{
-		_visibleRows++;
-	}
+	updateFont();
 }
 
 /**
@@ -409,15 +384,7 @@ void TextList::setSmall()
 {
 	_font = _small;
 
-	delete _selector;
-	_selector = new Surface(getWidth(), _font->getHeight() + _font->getSpacing(), getX(), getY());
-	_selector->setPalette(getPalette());
-	_selector->setVisible(false);
-
-	for (int y = 0; y < getHeight(); y += _font->getHeight() + _font->getSpacing())
-	{
-		_visibleRows++;
-	}
+	updateFont();
 }
 
 /**
@@ -487,6 +454,7 @@ void TextList::setArrowColumn(int pos, ArrowOrientation type)
 {
 	_arrowPos = pos;
 	_arrowType = type;
+	deleteTexts();
 }
 
 /**
@@ -572,15 +540,8 @@ void TextList::onRightArrowRelease(ActionHandler handler)
  */
 void TextList::clearList()
 {
-	for (std::vector< std::vector<Text*> >::iterator u = _texts.begin(); u < _texts.end(); ++u)
-	{
-		for (std::vector<Text*>::iterator v = u->begin(); v < u->end(); ++v)
-		{
-			delete (*v);
-		}
-		u->clear();
-	}
-	_texts.clear();
+	_rows.clear();
+	_redraw = true;
 }
 
 /**
@@ -588,7 +549,7 @@ void TextList::clearList()
  */
 void TextList::scrollUp()
 {
-	if (_texts.size() > _visibleRows && _scroll > 0)
+	if (_rows.size() > _visibleRows && _scroll > 0)
 	{
 		_scroll--;
 		_redraw = true;
@@ -601,7 +562,7 @@ void TextList::scrollUp()
  */
 void TextList::scrollDown()
 {
-	if (_texts.size() > _visibleRows && _scroll < _texts.size() - _visibleRows)
+	if (_rows.size() > _visibleRows && _scroll < _rows.size() - _visibleRows)
 	{
 		_scroll++;
 		_redraw = true;
@@ -615,22 +576,125 @@ void TextList::scrollDown()
  */
 void TextList::updateArrows()
 {
-	_up->setVisible((_texts.size() > _visibleRows && _scroll > 0));
-	_down->setVisible((_texts.size() > _visibleRows && _scroll < _texts.size() - _visibleRows));
+	_up->setVisible((_rows.size() > _visibleRows && _scroll > 0));
+	_down->setVisible((_rows.size() > _visibleRows && _scroll < _rows.size() - _visibleRows));
 }
 
 /**
- * Draws the text list and all the text contained within.
+ * Creates a row of Text's (and arrow buttons) for each row that
+ * fits in the list. These get reused to draw whichever rows are
+ * scrolled into view, so the list needs no more of them however
+ * many rows it holds.
+ */
+void TextList::createTexts()
+{
+	for (unsigned int i = 0; i < _visibleRows; ++i)
+	{
+		int y = i * (_font->getHeight() + _font->getSpacing());
+		std::vector<Text*> temp;
+		for (std::vector<int>::iterator j = _columns.begin(); j < _columns.end(); ++j)
+		{
+			Text* txt = new Text(*j, _font->getHeight(), 0, y);
+			txt->setPalette(this->getPalette());
+			txt->setFonts(_big, _small);
+			txt->setSecondaryColor(_color2);
+			txt->setAlign(_align);
+			txt->setHighContrast(_contrast);
+			if (_font == _big)
+			{
+				txt->setBig();
+			}
+			else
+			{
+				txt->setSmall();
+			}
+			temp.push_back(txt);
+		}
+		_texts.push_back(temp);
+
+		// Place arrow buttons
+		if (_arrowPos != -1)
+		{
+			ArrowShape shape1, shape2;
+			if (_arrowType == ARROW_VERTICAL)
+			{
+				shape1 = ARROW_SMALL_UP;
+				shape2 = ARROW_SMALL_DOWN;
+			}
+			else
+			{
+				shape1 = ARROW_SMALL_LEFT;
+				shape2 = ARROW_SMALL_RIGHT;
+			}
+			ArrowButton *a1 = new ArrowButton(shape1, 11, 8, getX() + _arrowPos, getY());
+			a1->setPalette(this->getPalette());
+			a1->setColor(_up->getColor());
+			a1->onMouseClick(_leftClick);
+			a1->onMousePress(_leftPress);
+			a1->onMouseRelease(_leftRelease);
+			_arrowLeft.push_back(a1);
+			ArrowButton *a2 = new ArrowButton(shape2, 11, 8, getX() + _arrowPos + 12, getY());
+			a2->setPalette(this->getPalette());
+			a2->setColor(_up->getColor());
+			a2->onMouseClick(_rightClick);
+			a2->onMousePress(_rightPress);
+			a2->onMouseRelease(_rightRelease);
+			_arrowRight.push_back(a2);
+		}
+	}
+}
+
+/**
+ * Deletes the Text's and arrow buttons used to draw the rows,
+ * so they're created again with the current settings.
+ */
+void TextList::deleteTexts()
+{
+	for (std::vector< std::vector<Text*> >::iterator u = _texts.begin(); u < _texts.end(); ++u)
+	{
+		for (std::vector<Text*>::iterator v = u->begin(); v < u->end(); ++v)
+		{
+			delete *v;
+		}
+	}
+	_texts.clear();
+	for (std::vector<ArrowButton*>::iterator i = _arrowLeft.begin(); i < _arrowLeft.end(); ++i)
+	{
+		delete *i;
+	}
+	_arrowLeft.clear();
+	for (std::vector<ArrowButton*>::iterator i = _arrowRight.begin(); i < _arrowRight.end(); ++i)
+	{
+		delete *i;
+	}
+	_arrowRight.clear();
+	_redraw = true;
+}
+
+/**
+ * Draws the text list and all the text contained within,
+ * filling in the visible rows with the ones scrolled into view.
  */
 void TextList::draw()
 {
 	Surface::draw();
-	for (unsigned int i = _scroll; i < _texts.size() && i < _scroll + _visibleRows; ++i)
+	if (_font == 0)
+	{
+		return;
+	}
+	if (_texts.empty())
+	{
+		createTexts();
+	}
+	for (unsigned int i = _scroll; i < _rows.size() && i < _scroll + _visibleRows; ++i)
 	{
-		for (std::vector<Text*>::iterator j = _texts[i].begin(); j < _texts[i].end(); ++j)
+		std::vector<Text*> &texts = _texts[i - _scroll];
+		for (unsigned int j = 0; j < _rows[i].size() && j < texts.size(); ++j)
 		{
-			(*j)->setY((i - _scroll) * (_font->getHeight() + _font->getSpacing()));
-			(*j)->blit(this);
+			texts[j]->setX(_rows[i][j].x);
+			texts[j]->setColor(_rows[i][j].color);
+			texts[j]->setText(_rows[i][j].text);
+			texts[j]->blit(this);
 		}
 	}
 }
@@ -652,11 +716,11 @@ void TextList::blit(Surface *surface)
 		_down->blit(surface);
 		if (_arrowPos != -1)
 		{
-			for (unsigned int i = _scroll; i < _texts.size() && i < _scroll + _visibleRows; ++i)
+			for (unsigned int i = 0; i < _arrowLeft.size() && _scroll + i < _rows.size(); ++i)
 			{
-				_arrowLeft[i]->setY(getY() + (i - _scroll) * (_font->getHeight() + _font->getSpacing()));
+				_arrowLeft[i]->setY(getY() + i * (_font->getHeight() + _font->getSpacing()));
 				_arrowLeft[i]->blit(surface);
-				_arrowRight[i]->setY(getY() + (i - _scroll) * (_font->getHeight() + _font->getSpacing()));
+				_arrowRight[i]->setY(getY() + i * (_font->getHeight() + _font->getSpacing()));
 				_arrowRight[i]->blit(surface);
 			}
 		}
@@ -675,7 +739,7 @@ void TextList::handle(Action *action, State *state)
 	_down->handle(action, state);
 	if (_arrowPos != -1)
 	{
-		for (unsigned int i = _scroll; i < _texts.size() && i < _scroll + _visibleRows; ++i)
+		for (unsigned int i = 0; i < _arrowLeft.size() && _scroll + i < _rows.size(); ++i)
 		{
 			_arrowLeft[i]->handle(action, state);
 			_arrowRight[i]->handle(action, state);
@@ -710,7 +774,7 @@ void TextList::mousePress(Action *action, State *state)
 {
 	if (_selectable && action->getDetails()->button.button == SDL_BUTTON_LEFT)
 	{
-		if (_selRow < _texts.size())
+		if (_selRow < _rows.size())
 		{
 			InteractiveSurface::mousePress(action, state);
 		}
@@ -734,7 +798,7 @@ void TextList::mouseRelease(Action *action, State *state)
 {
 	if (_selectable && action->getDetails()->button.button == SDL_BUTTON_LEFT)
 	{
-		if (_selRow < _texts.size())
+		if (_selRow < _rows.size())
 		{
 			InteractiveSurface::mouseRelease(action, state);
 		}
@@ -750,7 +814,7 @@ void TextList::mouseClick(Action *action, State *state)
 {
 	if (_selectable && action->getDetails()->button.button == SDL_BUTTON_LEFT)
 	{
-		if (_selRow < _texts.size())
+		if (_selRow < _rows.size())
 		{
 			InteractiveSurface::mouseClick(action, state);
 		}
@@ -769,7 +833,7 @@ void TextList::mouseOver(Action *action, State *state)
 		int h = _font->getHeight() + _font->getSpacing();
 		_selRow = _scroll + (int)floor(action->getRelativeYMouse() / (h * action->getYScale()));
 
-		if (_selRow < _texts.size())
+		if (_selRow < _rows.size())
 		{
 			_selector->setY(getY() + (_selRow - _scroll) * h);
 			_selector->copy(_bg);
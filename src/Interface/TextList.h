@@ -36,10 +36,22 @@ class ArrowButton;
  * Contains a set of Text's that are automatically lined up by
  * rows and columns, like a big table, making it easy to manage
  * them together.
+ * @note The list only stores the contents of each row. Text's
+ * (and arrow buttons) are only created for the rows that fit
+ * on screen, and are filled in with whichever rows are
+ * currently scrolled into view.
  */
 class TextList : public InteractiveSurface
 {
 private:
+	/// The contents of a cell in the list.
+	struct Cell
+	{
+		std::wstring text;
+		int x;
+		Uint8 color;
+	};
+	std::vector< std::vector<Cell> > _rows;
 	std::vector< std::vector<Text*> > _texts;
 	std::vector<int> _columns;
 	Font *_big, *_small, *_font;
@@ -58,6 +70,12 @@ private:
 
 	/// Updates the arrow buttons.
 	void updateArrows();
+	/// Updates the selector and visible rows for the current font.
+	void updateFont();
+	/// Creates the Text's and arrows for the visible rows.
+	void createTexts();
+	/// Deletes the Text's and arrows for the visible rows.
+	void deleteTexts();
 public:
 	/// Creates a text list with the specified size and position.
 	TextList(int width, int height, int x = 0, int y = 0);
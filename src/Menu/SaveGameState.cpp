@@ -20,6 +20,7 @@
 #include <iostream>
 #include "yaml.h"
 #include "../Savegame/SavedGame.h"
+#include "../Savegame/SaveWriter.h"
 #include "../Engine/Game.h"
 #include "../Engine/Action.h"
 #include "../Engine/Exception.h"
@@ -43,7 +44,7 @@ namespace OpenXcom
  * @param game Pointer to the core game.
  * @param geo True to use Geoscape palette, false to use Battlescape palette.
  */
-SaveGameState::SaveGameState(Game *game, bool geo) : State(game), _selected(""), _geo(geo)
+SaveGameState::SaveGameState(Game *game, bool geo) : State(game), _selected(""), _geo(geo), _writer(0)
 {
 	// Create objects
 	WindowPopup p = POPUP_BOTH;
@@ -154,7 +155,7 @@ SaveGameState::SaveGameState(Game *game, bool geo) : State(game), _selected(""),
  */
 SaveGameState::~SaveGameState()
 {
-
+	delete _writer;
 }
 
 /**
@@ -168,12 +169,49 @@ void SaveGameState::init()
 	}
 }
 
+/**
+ * Returns to the previous screen once the save
+ * being written in the background is done.
+ */
+void SaveGameState::think()
+{
+	State::think();
+
+	if (_writer != 0 && _writer->isDone())
+	{
+		bool success = _writer->wait();
+		if (!success)
+		{
+			std::cerr << "ERROR: " << _writer->getError() << std::endl;
+		}
+		delete _writer;
+		_writer = 0;
+		_game->popState();
+		if (!success)
+		{
+			_game->pushState(new GeoscapeErrorState(_game, "STR_SAVE_UNSUCCESSFUL"));
+		}
+	}
+}
+
+/**
+ * Keeps the game cycling while the save is
+ * being written, to notice as soon as it's done.
+ * @return True if the game shouldn't sleep.
+ */
+bool SaveGameState::isBusy() const
+{
+	return _writer != 0;
+}
+
 /**
  * Returns to the previous screen.
  * @param action Pointer to an action.
  */
 void SaveGameState::btnCancelClick(Action *action)
 {
+	if (_writer != 0)
+		return;
 	_game->popState();
 }
 
@@ -221,7 +259,7 @@ void SaveGameState::lstSavesClick(Action *action)
  */
 void SaveGameState::edtSaveKeyPress(Action *action)
 {
-	if (action->getDetails()->key.keysym.sym == SDLK_RETURN)
+	if (action->getDetails()->key.keysym.sym == SDLK_RETURN && _writer == 0)
 	{
 		try
 		{
@@ -234,19 +272,20 @@ void SaveGameState::edtSaveKeyPress(Action *action)
 					throw Exception("Failed to overwrite save");
 				}
 			}
-			_game->getSavedGame()->save(Language::wstrToUtf8(_edtSave->getText()));
+			_edtSave->setVisible(false);
+			_writer = _game->getSavedGame()->saveAsync(Language::wstrToUtf8(_edtSave->getText()));
+			return;
 		}
 		catch (Exception &e)
 		{
 			std::cerr << "ERROR: " << e.what() << std::endl;
-			_game->pushState(new GeoscapeErrorState(_game, "STR_SAVE_UNSUCCESSFUL"));
 		}
 		catch (YAML::Exception &e)
 		{
 			std::cerr << "ERROR: " << e.what() << std::endl;
-			_game->pushState(new GeoscapeErrorState(_game, "STR_SAVE_UNSUCCESSFUL"));
 		}
 		_game->popState();
+		_game->pushState(new GeoscapeErrorState(_game, "STR_SAVE_UNSUCCESSFUL"));
 	}
 }
 
@@ -30,6 +30,7 @@ class Window;
 class Text;
 class TextList;
 class TextEdit;
+class SaveWriter;
 
 /**
  * Save Game screen for listing info on available
@@ -46,6 +47,7 @@ private:
 	std::string _selected;
 	bool _geo;
 	int _previousSelectedRow, _selectedRow;
+	SaveWriter *_writer;
 public:
 	/// Creates the Save Game state.
 	SaveGameState(Game *game, bool geo);
@@ -53,6 +55,10 @@ public:
 	~SaveGameState();
 	/// Updates the palette.
 	void init();
+	/// Checks if the save has been written.
+	void think();
+	/// Checks if the save is being written.
+	bool isBusy() const;
 	/// Handler for clicking the Cancel button.
 	void btnCancelClick(Action *action);
 	/// Handler for pressing a key on the Save edit.
@@ -24,6 +24,7 @@
 #include "../Engine/Surface.h"
 #include "../Engine/Exception.h"
 #include "../Engine/Options.h"
+#include "../Engine/AssetCache.h"
 #include "TestState.h"
 #include "NoteState.h"
 #include "MainMenuState.h"
@@ -79,7 +80,12 @@ void StartState::think()
 	case LOADING_STARTED:
 		try
 		{
+			if (Options::getBool("assetCache"))
+			{
+				AssetCache::open(Options::getUserFolder() + "assets.cache");
+			}
 			_game->setResourcePack(new XcomResourcePack());
+			AssetCache::save();
 			_load = LOADING_SUCCESSFUL;
 		}
 		catch (Exception &e)
@@ -115,6 +121,16 @@ void StartState::think()
 	}
 }
 
+/**
+ * Keeps the game cycling until the loading
+ * is finished or has failed.
+ * @return True if the game shouldn't sleep.
+ */
+bool StartState::isBusy() const
+{
+	return _load != LOADING_FAILED;
+}
+
 /**
  * The game quits if the player presses any key when an error
  * message is on display.
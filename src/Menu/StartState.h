@@ -43,6 +43,8 @@ public:
 	~StartState();
 	/// Loads the game resources.
 	void think();
+	/// Checks if the resources are still loading.
+	bool isBusy() const;
 	/// Handles key clicks.
 	void handle(Action *action);
 };
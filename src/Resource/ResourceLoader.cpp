@@ -0,0 +1,218 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ResourceLoader.h"
+#include "../Engine/Surface.h"
+#include "../Engine/SurfaceSet.h"
+#include "../Engine/SoundSet.h"
+#include "../Engine/Exception.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Initializes a loader with nothing queued.
+ */
+ResourceLoader::ResourceLoader() : _jobs(), _threads(), _next(0), _error(""), _mutex(0)
+{
+	_mutex = SDL_CreateMutex();
+}
+
+/**
+ * Waits for any running threads and cleans up.
+ */
+ResourceLoader::~ResourceLoader()
+{
+	for (std::vector<SDL_Thread*>::iterator i = _threads.begin(); i != _threads.end(); ++i)
+	{
+		SDL_WaitThread(*i, 0);
+	}
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Adds a file to the queue of files to decode.
+ * Files can't be queued once loading has started.
+ * @param type Type of file.
+ * @param resource Pointer to the resource to load into.
+ * @param file Full path to the file.
+ * @param tab Full path to the PCK tab file, if any.
+ * @param wav True if the CAT sounds are in WAV format.
+ */
+void ResourceLoader::add(LoadType type, void *resource, const std::string &file, const std::string &tab, bool wav)
+{
+	LoadJob job;
+	job.type = type;
+	job.resource = resource;
+	job.file = file;
+	job.tab = tab;
+	job.wav = wav;
+	_jobs.push_back(job);
+}
+
+/**
+ * Queues a SCR image to be loaded into a surface.
+ * @param surface Pointer to the surface.
+ * @param file Full path to the file.
+ */
+void ResourceLoader::addScr(Surface *surface, const std::string &file)
+{
+	add(LOAD_SCR, surface, file);
+}
+
+/**
+ * Queues a SPK image to be loaded into a surface.
+ * @param surface Pointer to the surface.
+ * @param file Full path to the file.
+ */
+void ResourceLoader::addSpk(Surface *surface, const std::string &file)
+{
+	add(LOAD_SPK, surface, file);
+}
+
+/**
+ * Queues a PCK sprite set to be loaded into a surface set.
+ * @param set Pointer to the surface set.
+ * @param pck Full path to the PCK file.
+ * @param tab Full path to the TAB file.
+ */
+void ResourceLoader::addPck(SurfaceSet *set, const std::string &pck, const std::string &tab)
+{
+	add(LOAD_PCK, set, pck, tab);
+}
+
+/**
+ * Queues a DAT sprite set to be loaded into a surface set.
+ * @param set Pointer to the surface set.
+ * @param file Full path to the file.
+ */
+void ResourceLoader::addDat(SurfaceSet *set, const std::string &file)
+{
+	add(LOAD_DAT, set, file);
+}
+
+/**
+ * Queues a CAT sound set to be loaded into a sound set.
+ * @param set Pointer to the sound set.
+ * @param file Full path to the file.
+ * @param wav True if the sounds are in WAV format.
+ */
+void ResourceLoader::addCat(SoundSet *set, const std::string &file, bool wav)
+{
+	add(LOAD_CAT, set, file, "", wav);
+}
+
+/**
+ * Takes queued files one at a time and decodes them,
+ * until the queue runs out or a file fails to load.
+ */
+void ResourceLoader::work()
+{
+	while (true)
+	{
+		SDL_LockMutex(_mutex);
+		if (_next >= _jobs.size() || !_error.empty())
+		{
+			SDL_UnlockMutex(_mutex);
+			return;
+		}
+		LoadJob &job = _jobs[_next++];
+		SDL_UnlockMutex(_mutex);
+
+		try
+		{
+			switch (job.type)
+			{
+			case LOAD_SCR:
+				((Surface*)job.resource)->loadScr(job.file);
+				break;
+			case LOAD_SPK:
+				((Surface*)job.resource)->loadSpk(job.file);
+				break;
+			case LOAD_PCK:
+				((SurfaceSet*)job.resource)->loadPck(job.file, job.tab);
+				break;
+			case LOAD_DAT:
+				((SurfaceSet*)job.resource)->loadDat(job.file);
+				break;
+			case LOAD_CAT:
+				((SoundSet*)job.resource)->loadCat(job.file, job.wav);
+				break;
+			}
+		}
+		catch (std::exception &e)
+		{
+			SDL_LockMutex(_mutex);
+			if (_error.empty())
+			{
+				_error = e.what();
+			}
+			SDL_UnlockMutex(_mutex);
+		}
+	}
+}
+
+/**
+ * Entry point of the worker threads.
+ * @param loader Pointer to the loader.
+ * @return Always zero.
+ */
+int ResourceLoader::run(void *loader)
+{
+	((ResourceLoader*)loader)->work();
+	return 0;
+}
+
+/**
+ * Starts decoding the queued files on a number of
+ * background threads, so the main thread can get on
+ * with loading anything that has to be done there.
+ * @param threads Number of background threads.
+ */
+void ResourceLoader::start(int threads)
+{
+	for (int i = 0; i < threads; ++i)
+	{
+		SDL_Thread *thread = SDL_CreateThread(run, this);
+		if (thread == 0)
+			break;
+		_threads.push_back(thread);
+	}
+}
+
+/**
+ * Helps the background threads decode the remaining files
+ * and waits for them all to be done. Without any background
+ * threads, all the files are just decoded here.
+ * @throw Exception if any file failed to load.
+ */
+void ResourceLoader::finish()
+{
+	work();
+	for (std::vector<SDL_Thread*>::iterator i = _threads.begin(); i != _threads.end(); ++i)
+	{
+		SDL_WaitThread(*i, 0);
+	}
+	_threads.clear();
+	if (!_error.empty())
+	{
+		throw Exception(_error);
+	}
+}
+
+}
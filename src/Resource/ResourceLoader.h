@@ -0,0 +1,89 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_RESOURCELOADER_H
+#define OPENXCOM_RESOURCELOADER_H
+
+#include <string>
+#include <vector>
+#include "SDL.h"
+
+namespace OpenXcom
+{
+
+class Surface;
+class SurfaceSet;
+class SoundSet;
+
+/**
+ * Decodes a batch of resource files on several threads at once.
+ * The resources are created on the main thread and queued up,
+ * then only their files are read and decoded on the threads,
+ * since none of them depend on each other or on the palettes.
+ */
+class ResourceLoader
+{
+private:
+	/// Types of file a loader can decode.
+	enum LoadType { LOAD_SCR, LOAD_SPK, LOAD_PCK, LOAD_DAT, LOAD_CAT };
+
+	/// A file to decode into a resource.
+	struct LoadJob
+	{
+		LoadType type;
+		void *resource;
+		std::string file, tab;
+		bool wav;
+	};
+
+	std::vector<LoadJob> _jobs;
+	std::vector<SDL_Thread*> _threads;
+	size_t _next;
+	std::string _error;
+	SDL_mutex *_mutex;
+
+	/// Adds a file to the queue.
+	void add(LoadType type, void *resource, const std::string &file, const std::string &tab = "", bool wav = true);
+	/// Decodes queued files until there are none left.
+	void work();
+	/// Runs a worker thread.
+	static int run(void *loader);
+public:
+	/// Creates an empty loader.
+	ResourceLoader();
+	/// Cleans up the loader.
+	~ResourceLoader();
+	/// Queues a SCR image.
+	void addScr(Surface *surface, const std::string &file);
+	/// Queues a SPK image.
+	void addSpk(Surface *surface, const std::string &file);
+	/// Queues a PCK sprite set.
+	void addPck(SurfaceSet *set, const std::string &pck, const std::string &tab);
+	/// Queues a DAT sprite set.
+	void addDat(SurfaceSet *set, const std::string &file);
+	/// Queues a CAT sound set.
+	void addCat(SoundSet *set, const std::string &file, bool wav);
+	/// Starts decoding the queued files in the background.
+	void start(int threads);
+	/// Waits for all the queued files to be decoded.
+	void finish();
+};
+
+}
+
+#endif
@@ -17,6 +17,7 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "ResourcePack.h"
+#include <algorithm>
 #include "../Engine/Palette.h"
 #include "../Engine/Font.h"
 #include "../Engine/Surface.h"
@@ -26,6 +27,10 @@
 #include "../Geoscape/Polygon.h"
 #include "../Geoscape/Polyline.h"
 #include "../Engine/SoundSet.h"
+#include "../Engine/GMCat.h"
+#include "../Engine/Options.h"
+#include "../Engine/CrossPlatform.h"
+#include "ResourceLoader.h"
 
 namespace OpenXcom
 {
@@ -33,8 +38,13 @@ namespace OpenXcom
 /**
  * Initializes a blank resource set pointing to a folder.
  */
-ResourcePack::ResourcePack() : _palettes(), _fonts(), _surfaces(), _sets(), _polygons(), _musics()
+ResourcePack::ResourcePack() : _palettes(), _fonts(), _surfaces(), _sets(), _polygons(), _musics(), _lazy(), _lastUsed(), _uses(0), _currentMusic("")
 {
+	for (int i = 0; i < 256; ++i)
+	{
+		_colors[i].r = _colors[i].g = _colors[i].b = 0;
+		_colors[i].unused = 0;
+	}
 }
 
 /**
@@ -93,7 +103,13 @@ Font *const ResourcePack::getFont(const std::string &name) const
  */
 Surface *const ResourcePack::getSurface(const std::string &name) const
 {
-	return _surfaces.find(name)->second;
+	std::map<std::string, Surface*>::const_iterator i = _surfaces.find(name);
+	if (i == _surfaces.end() && loadLazy(name))
+	{
+		i = _surfaces.find(name);
+	}
+	touch(name);
+	return i->second;
 }
 
 /**
@@ -103,7 +119,13 @@ Surface *const ResourcePack::getSurface(const std::string &name) const
  */
 SurfaceSet *const ResourcePack::getSurfaceSet(const std::string &name) const
 {
-	return _sets.find(name)->second;
+	std::map<std::string, SurfaceSet*>::const_iterator i = _sets.find(name);
+	if (i == _sets.end() && loadLazy(name))
+	{
+		i = _sets.find(name);
+	}
+	touch(name);
+	return i->second;
 }
 
 /**
@@ -131,7 +153,14 @@ std::list<Polyline*> *const ResourcePack::getPolylines()
  */
 Music *const ResourcePack::getMusic(const std::string &name) const
 {
-	return _musics.find(name)->second;
+	std::map<std::string, Music*>::const_iterator i = _musics.find(name);
+	if (i == _musics.end() && loadLazy(name))
+	{
+		i = _musics.find(name);
+	}
+	touch(name);
+	_currentMusic = name;
+	return i->second;
 }
 
 /**
@@ -162,6 +191,10 @@ Palette *const ResourcePack::getPalette(const std::string &name) const
  */
 void ResourcePack::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
+	for (int i = 0; i < ncolors && firstcolor + i < 256; ++i)
+	{
+		_colors[firstcolor + i] = colors[i];
+	}
 	for (std::map<std::string, Font*>::iterator i = _fonts.begin(); i != _fonts.end(); ++i)
 	{
 		i->second->getSurface()->setPalette(colors, firstcolor, ncolors);
@@ -185,4 +218,248 @@ std::vector<Uint16> *const ResourcePack::getVoxelData()
 	return &_voxelData;
 }
 
+/**
+ * Registers a resource that's only loaded the first time it's
+ * asked for, instead of when the resource pack is created.
+ * @param name Name of the resource.
+ * @param type Type of file to load it from.
+ * @param file Full path to the file.
+ * @param width Width of the surface or frames. Track number for GM.CAT music.
+ * @param height Height of the surface or frames.
+ * @param transient True if nothing keeps a pointer to the resource,
+ * so it can be unloaded when it's not needed.
+ * @param tab Full path to the PCK tab file.
+ */
+void ResourcePack::addLazy(const std::string &name, LazyType type, const std::string &file, int width, int height, bool transient, const std::string &tab)
+{
+	LazyResource res;
+	res.type = type;
+	res.file = file;
+	res.tab = tab;
+	res.width = width;
+	res.height = height;
+	res.transient = transient;
+	_lazy[name] = res;
+}
+
+/**
+ * Creates a resource registered for loading on demand.
+ * Images are queued up in a loader to be decoded later,
+ * music is loaded right away.
+ * @param name Name of the resource.
+ * @param loader Pointer to the loader to queue images in.
+ * @return True if the resource is registered and wasn't loaded yet.
+ */
+bool ResourcePack::queueLazy(const std::string &name, ResourceLoader *loader) const
+{
+	std::map<std::string, LazyResource>::const_iterator i = _lazy.find(name);
+	if (i == _lazy.end() || _surfaces.find(name) != _surfaces.end() || _sets.find(name) != _sets.end() || _musics.find(name) != _musics.end())
+	{
+		return false;
+	}
+	const LazyResource &res = i->second;
+	switch (res.type)
+	{
+	case LAZY_SCR:
+		_surfaces[name] = new Surface(res.width, res.height);
+		loader->addScr(_surfaces[name], res.file);
+		break;
+	case LAZY_SPK:
+		_surfaces[name] = new Surface(res.width, res.height);
+		loader->addSpk(_surfaces[name], res.file);
+		break;
+	case LAZY_PCK:
+		_sets[name] = new SurfaceSet(res.width, res.height);
+		loader->addPck(_sets[name], res.file, res.tab);
+		break;
+	case LAZY_DAT:
+		_sets[name] = new SurfaceSet(res.width, res.height);
+		loader->addDat(_sets[name], res.file);
+		break;
+	case LAZY_MUSIC:
+		_musics[name] = new Music();
+		_musics[name]->load(res.file);
+		break;
+	case LAZY_GMCAT:
+		{
+			GMCatFile gmcat(res.file.c_str());
+			_musics[name] = gmcat.loadMIDI(res.width);
+		}
+		break;
+	}
+	return true;
+}
+
+/**
+ * Applies the last palette set on the resource pack to
+ * a resource that has just been loaded on demand.
+ * @param name Name of the resource.
+ */
+void ResourcePack::paletteLazy(const std::string &name) const
+{
+	std::map<std::string, Surface*>::const_iterator surface = _surfaces.find(name);
+	if (surface != _surfaces.end())
+	{
+		surface->second->setPalette((SDL_Color*)_colors, 0, 256);
+	}
+	std::map<std::string, SurfaceSet*>::const_iterator set = _sets.find(name);
+	if (set != _sets.end())
+	{
+		set->second->setPalette((SDL_Color*)_colors, 0, 256);
+	}
+}
+
+/**
+ * Loads a resource registered for loading on demand.
+ * @param name Name of the resource.
+ * @return True if the resource was loaded.
+ */
+bool ResourcePack::loadLazy(const std::string &name) const
+{
+	ResourceLoader loader;
+	if (!queueLazy(name, &loader))
+	{
+		return false;
+	}
+	loader.finish();
+	paletteLazy(name);
+	return true;
+}
+
+/**
+ * Marks a transient resource as just used,
+ * so it's the last in line to be unloaded.
+ * @param name Name of the resource.
+ */
+void ResourcePack::touch(const std::string &name) const
+{
+	std::map<std::string, LazyResource>::const_iterator i = _lazy.find(name);
+	if (i != _lazy.end() && i->second.transient)
+	{
+		_lastUsed[name] = ++_uses;
+	}
+}
+
+/**
+ * Returns roughly how much memory a loaded resource takes.
+ * @param name Name of the resource.
+ * @return Size in bytes.
+ */
+size_t ResourcePack::getMemory(const std::string &name) const
+{
+	std::map<std::string, Surface*>::const_iterator surface = _surfaces.find(name);
+	if (surface != _surfaces.end())
+	{
+		return surface->second->getWidth() * surface->second->getHeight();
+	}
+	std::map<std::string, SurfaceSet*>::const_iterator set = _sets.find(name);
+	if (set != _sets.end())
+	{
+		return set->second->getWidth() * set->second->getHeight() * set->second->getTotalFrames();
+	}
+	std::map<std::string, LazyResource>::const_iterator lazy = _lazy.find(name);
+	if (lazy != _lazy.end() && lazy->second.type == LAZY_MUSIC)
+	{
+		time_t modified;
+		long size;
+		if (CrossPlatform::getFileInfo(lazy->second.file, &modified, &size))
+		{
+			return size;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Deletes a resource loaded on demand. It's
+ * loaded again the next time it's asked for.
+ * @param name Name of the resource.
+ */
+void ResourcePack::unload(const std::string &name)
+{
+	std::map<std::string, Surface*>::iterator surface = _surfaces.find(name);
+	if (surface != _surfaces.end())
+	{
+		delete surface->second;
+		_surfaces.erase(surface);
+	}
+	std::map<std::string, SurfaceSet*>::iterator set = _sets.find(name);
+	if (set != _sets.end())
+	{
+		delete set->second;
+		_sets.erase(set);
+	}
+	std::map<std::string, Music*>::iterator music = _musics.find(name);
+	if (music != _musics.end())
+	{
+		delete music->second;
+		_musics.erase(music);
+	}
+	_lastUsed.erase(name);
+}
+
+/**
+ * Loads a batch of resources before they're needed,
+ * decoding them all at once on the loading threads,
+ * so a screen doesn't stall on them one by one.
+ * Resources that are already loaded are just marked as used.
+ * @param names Names of the resources.
+ */
+void ResourcePack::prefetch(const std::vector<std::string> &names)
+{
+	ResourceLoader loader;
+	std::vector<std::string> loaded;
+	for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i)
+	{
+		if (queueLazy(*i, &loader))
+		{
+			loaded.push_back(*i);
+		}
+		touch(*i);
+	}
+	loader.start(Options::getInt("loadingThreads"));
+	loader.finish();
+	for (std::vector<std::string>::const_iterator i = loaded.begin(); i != loaded.end(); ++i)
+	{
+		paletteLazy(*i);
+	}
+}
+
+/**
+ * Unloads the least recently used transient resources until
+ * they fit in the memory budget set in the options.
+ * The music that's currently playing is never unloaded.
+ */
+void ResourcePack::trim()
+{
+	size_t budget = std::max(0, Options::getInt("resourceBudget")) * 1024;
+	if (budget == 0)
+	{
+		return;
+	}
+	size_t total = 0;
+	for (std::map<std::string, Uint32>::const_iterator i = _lastUsed.begin(); i != _lastUsed.end(); ++i)
+	{
+		total += getMemory(i->first);
+	}
+	while (total > budget)
+	{
+		std::map<std::string, Uint32>::const_iterator oldest = _lastUsed.end();
+		for (std::map<std::string, Uint32>::const_iterator i = _lastUsed.begin(); i != _lastUsed.end(); ++i)
+		{
+			if (i->first != _currentMusic && (oldest == _lastUsed.end() || i->second < oldest->second))
+			{
+				oldest = i;
+			}
+		}
+		if (oldest == _lastUsed.end())
+		{
+			break;
+		}
+		std::string name = oldest->first;
+		total -= std::min(total, getMemory(name));
+		unload(name);
+	}
+}
+
 }
@@ -39,6 +39,7 @@ class SoundSet;
 class SavedBattleGame;
 class RuleTerrain;
 class MapBlock;
+class ResourceLoader;
 
 /**
  * Packs of external game media.
@@ -52,15 +53,47 @@ class MapBlock;
 class ResourcePack
 {
 protected:
+	/// Types of resource that can be loaded on demand.
+	enum LazyType { LAZY_SCR, LAZY_SPK, LAZY_PCK, LAZY_DAT, LAZY_MUSIC, LAZY_GMCAT };
+
+	/// Where to load a resource from the first time it's needed.
+	struct LazyResource
+	{
+		LazyType type;
+		std::string file, tab;
+		int width, height;
+		bool transient;
+	};
+
 	std::map<std::string, Palette*> _palettes;
 	std::map<std::string, Font*> _fonts;
-	std::map<std::string, Surface*> _surfaces;
-	std::map<std::string, SurfaceSet*> _sets;
+	mutable std::map<std::string, Surface*> _surfaces;
+	mutable std::map<std::string, SurfaceSet*> _sets;
 	std::map<std::string, SoundSet*> _sounds;
 	std::list<Polygon*> _polygons;
 	std::list<Polyline*> _polylines;
-	std::map<std::string, Music*> _musics;
+	mutable std::map<std::string, Music*> _musics;
 	std::vector<Uint16> _voxelData;
+	std::map<std::string, LazyResource> _lazy;
+	mutable std::map<std::string, Uint32> _lastUsed;
+	mutable Uint32 _uses;
+	mutable std::string _currentMusic;
+	SDL_Color _colors[256];
+
+	/// Registers a resource to be loaded on first use.
+	void addLazy(const std::string &name, LazyType type, const std::string &file, int width = 0, int height = 0, bool transient = false, const std::string &tab = "");
+	/// Creates a resource registered for loading on demand and queues up its file.
+	bool queueLazy(const std::string &name, ResourceLoader *loader) const;
+	/// Sets the current palette on a resource loaded on demand.
+	void paletteLazy(const std::string &name) const;
+	/// Loads a resource registered for loading on demand.
+	bool loadLazy(const std::string &name) const;
+	/// Marks a resource as just used.
+	void touch(const std::string &name) const;
+	/// Gets the memory taken by a loaded resource.
+	size_t getMemory(const std::string &name) const;
+	/// Unloads a resource that can be loaded again on demand.
+	void unload(const std::string &name);
 public:
 	/// Create a new resource pack with a folder's contents.
 	ResourcePack();
@@ -86,6 +119,10 @@ public:
 	void setPalette(SDL_Color *colors, int firstcolor, int ncolors);
 	/// Gets list of voxel data.
 	std::vector<Uint16> *const getVoxelData();
+	/// Loads resources ahead of their first use.
+	void prefetch(const std::vector<std::string> &names);
+	/// Unloads unused resources over the memory budget.
+	void trim();
 };
 
 }
@@ -26,7 +26,6 @@
 #include "../Engine/SurfaceSet.h"
 #include "../Engine/Language.h"
 #include "../Engine/Music.h"
-#include "../Engine/GMCat.h"
 #include "../Engine/SoundSet.h"
 #include "../Engine/Options.h"
 #include "../Geoscape/Globe.h"
@@ -40,6 +39,7 @@
 #include "../Savegame/NodeLink.h"
 #include "../Battlescape/Position.h"
 #include "../Ruleset/MapDataSet.h"
+#include "ResourceLoader.h"
 
 namespace OpenXcom
 {
@@ -47,9 +47,13 @@ namespace OpenXcom
 /**
  * Initializes the resource pack by loading all the resources
  * contained in the original game folder.
+ * Image and sound files are decoded on several threads while
+ * the rest is loaded here.
  */
 XcomResourcePack::XcomResourcePack() : ResourcePack()
 {
+	ResourceLoader loader;
+
 	// Load palettes
 	for (int i = 0; i < 5; ++i)
 	{
@@ -80,8 +84,7 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 			_fonts[font[i]] = new Font(16, 16, 0);
 		else if (font[i] == "Small.fnt")
 			_fonts[font[i]] = new Font(8, 9, -1);
-		_fonts[font[i]]->getSurface()->loadScr(CrossPlatform::getDataFile(s.str()));
-		_fonts[font[i]]->load();
+		loader.addScr(_fonts[font[i]]->getSurface(), CrossPlatform::getDataFile(s.str()));
 	}
 
 	// Load surfaces
@@ -89,7 +92,7 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 		std::stringstream s;
 		s << "GEODATA/" << "INTERWIN.DAT";
 		_surfaces["INTERWIN.DAT"] = new Surface(160, 556);
-		_surfaces["INTERWIN.DAT"]->loadScr(CrossPlatform::getDataFile(s.str()));
+		loader.addScr(_surfaces["INTERWIN.DAT"], CrossPlatform::getDataFile(s.str()));
 	}
 
 	std::string scrs[] = {"BACK01.SCR",
@@ -117,7 +120,7 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 		std::stringstream s;
 		s << "GEOGRAPH/" << scrs[i];
 		_surfaces[scrs[i]] = new Surface(320, 200);
-		_surfaces[scrs[i]]->loadScr(CrossPlatform::getDataFile(s.str()));
+		loader.addScr(_surfaces[scrs[i]], CrossPlatform::getDataFile(s.str()));
 	}
 
 	std::string spks[] = {"UP001.SPK",
@@ -164,12 +167,20 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 						  "UP042.SPK",
 						  "GRAPHS.SPK"};
 
+	// UFOpaedia images are only loaded when viewed
 	for (int i = 0; i < 43; ++i)
 	{
 		std::stringstream s;
 		s << "GEOGRAPH/" << spks[i];
-		_surfaces[spks[i]] = new Surface(320, 200);
-		_surfaces[spks[i]]->loadSpk(CrossPlatform::getDataFile(s.str()));
+		if (spks[i] == "GRAPHS.SPK")
+		{
+			_surfaces[spks[i]] = new Surface(320, 200);
+			loader.addSpk(_surfaces[spks[i]], CrossPlatform::getDataFile(s.str()));
+		}
+		else
+		{
+			addLazy(spks[i], LAZY_SPK, CrossPlatform::getDataFile(s.str()), 320, 200, true);
+		}
 	}
 
 	// Load surface sets
@@ -189,18 +200,72 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 			std::stringstream s2;
 			s2 << "GEOGRAPH/" << tab;
 			_sets[sets[i]] = new SurfaceSet(32, 40);
-			_sets[sets[i]]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+			loader.addPck(_sets[sets[i]], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 		}
 		else
 		{
 			_sets[sets[i]] = new SurfaceSet(32, 32);
-			_sets[sets[i]]->loadDat(CrossPlatform::getDataFile(s.str()));
+			loader.addDat(_sets[sets[i]], CrossPlatform::getDataFile(s.str()));
 		}
 	}
 	_sets["SCANG.DAT"] = new SurfaceSet(4, 4);
 	std::stringstream scang;
 	scang << "GEODATA/" << "SCANG.DAT";
-	_sets["SCANG.DAT"]->loadDat (CrossPlatform::getDataFile(scang.str()));
+	loader.addDat(_sets["SCANG.DAT"], CrossPlatform::getDataFile(scang.str()));
+
+	if (!Options::getBool("mute"))
+	{
+		// Load sounds
+		std::string catsId[] = {"GEO.CAT",
+								"BATTLE.CAT",
+								"INTRO.CAT"};
+		std::string catsDos[] = {"SOUND2.CAT",
+								 "SOUND1.CAT",
+								 "INTRO.CAT"};
+		std::string catsWin[] = {"SAMPLE.CAT",
+								 "SAMPLE2.CAT",
+								 "SAMPLE3.CAT"};
+
+		// Check which sound version is available
+		std::string *cats = 0;
+		bool wav = true;
+
+		std::stringstream win, dos;
+		win << "SOUND/" << catsWin[0];
+		dos << "SOUND/" << catsDos[0];
+		struct stat sndInfo;
+		if (stat(CrossPlatform::getDataFile(win.str()).c_str(), &sndInfo) == 0)
+		{
+			cats = catsWin;
+			wav = true;
+		}
+		else if (stat(CrossPlatform::getDataFile(dos.str()).c_str(), &sndInfo) == 0)
+		{
+			cats = catsDos;
+			wav = false;
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (cats == 0)
+			{
+				_sounds[catsId[i]] = new SoundSet();
+			}
+			else
+			{
+				std::stringstream s;
+				s << "SOUND/" << cats[i];
+				_sounds[catsId[i]] = new SoundSet();
+				loader.addCat(_sounds[catsId[i]], CrossPlatform::getDataFile(s.str()), wav);
+			}
+		}
+	}
+
+	loadBattlescapeResources(&loader); // TODO load this at battlescape start, unload at battlescape end?
+
+	// Everything else is loaded while the files above are decoded
+	loader.start(Options::getInt("loadingThreads"));
+
 	// Load polygons
 	std::stringstream s;
 	s << "GEODATA/" << "WORLD.DAT";
@@ -294,29 +359,28 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 
 		// Check which music version is available
 		bool cat = true;
-		GMCatFile *gmcat = 0;
 
 		std::string musDos = "SOUND/GM.CAT";
 		struct stat musInfo;
 		if (stat(CrossPlatform::getDataFile(musDos).c_str(), &musInfo) == 0)
 		{
 			cat = true;
-			gmcat = new GMCatFile(CrossPlatform::getDataFile(musDos).c_str());
 		}
 		else
 		{
 			cat = false;
 		}
 
+		// Music is only loaded when played
 		for (int i = 0; i < 14; ++i)
 		{
 			if (cat)
 			{
-				_musics[mus[i]] = gmcat->loadMIDI(tracks[i]);
+				addLazy(mus[i], LAZY_GMCAT, CrossPlatform::getDataFile(musDos), tracks[i], 0, true);
 			}
 			else
 			{
-				_musics[mus[i]] = new Music();
+				bool found = false;
 				for (int j = 0; j < 3; ++j)
 				{
 					std::stringstream s;
@@ -324,66 +388,33 @@ XcomResourcePack::XcomResourcePack() : ResourcePack()
 					struct stat info;
 					if (stat(CrossPlatform::getDataFile(s.str()).c_str(), &info) == 0)
 					{
-						_musics[mus[i]]->load(CrossPlatform::getDataFile(s.str()));
+						addLazy(mus[i], LAZY_MUSIC, CrossPlatform::getDataFile(s.str()), 0, 0, true);
+						found = true;
 						break;
 					}
 				}
+				if (!found)
+				{
+					_musics[mus[i]] = new Music();
+				}
 			}
 		}
-		delete gmcat;
-
-		// Load sounds
-		std::string catsId[] = {"GEO.CAT",
-								"BATTLE.CAT",
-								"INTRO.CAT"};
-		std::string catsDos[] = {"SOUND2.CAT",
-								 "SOUND1.CAT",
-								 "INTRO.CAT"};
-		std::string catsWin[] = {"SAMPLE.CAT",
-								 "SAMPLE2.CAT",
-								 "SAMPLE3.CAT"};
-
-		// Check which sound version is available
-		std::string *cats = 0;
-		bool wav = true;
+	}
 
-		std::stringstream win, dos;
-		win << "SOUND/" << catsWin[0];
-		dos << "SOUND/" << catsDos[0];
-		struct stat sndInfo;
-		if (stat(CrossPlatform::getDataFile(win.str()).c_str(), &sndInfo) == 0)
-		{
-			cats = catsWin;
-			wav = true;
-		}
-		else if (stat(CrossPlatform::getDataFile(dos.str()).c_str(), &sndInfo) == 0)
-		{
-			cats = catsDos;
-			wav = false;
-		}
+	loader.finish();
 
-		for (int i = 0; i < 3; ++i)
-		{
-			if (cats == 0)
-			{
-				_sounds[catsId[i]] = new SoundSet();
-			}
-			else
-			{
-				std::stringstream s;
-				s << "SOUND/" << cats[i];
-				_sounds[catsId[i]] = new SoundSet();
-				_sounds[catsId[i]]->loadCat(CrossPlatform::getDataFile(s.str()), wav);
-			}
-		}
+	for (std::map<std::string, Font*>::iterator i = _fonts.begin(); i != _fonts.end(); ++i)
+	{
+		i->second->load();
+	}
 
+	if (!Options::getBool("mute"))
+	{
 		TextButton::soundPress = _sounds["GEO.CAT"]->getSound(0);
 		Window::soundPopup[0] = _sounds["GEO.CAT"]->getSound(1);
 		Window::soundPopup[1] = _sounds["GEO.CAT"]->getSound(2);
 		Window::soundPopup[2] = _sounds["GEO.CAT"]->getSound(3);
 	}
-
-	loadBattlescapeResources(); // TODO load this at battlescape start, unload at battlescape end?
 }
 
 /**
@@ -394,59 +425,63 @@ XcomResourcePack::~XcomResourcePack()
 }
 
 
-void XcomResourcePack::loadBattlescapeResources()
+/**
+ * Queues up the battlescape specific resources to be loaded.
+ * @param loader Pointer to the loader to decode the files with.
+ */
+void XcomResourcePack::loadBattlescapeResources(ResourceLoader *loader)
 {
 	// Load Battlescape ICONS
 	std::stringstream s;
 	s << "UFOGRAPH/" << "ICONS.PCK";
 	_surfaces["ICONS.PCK"] = new Surface(320, 200);
-	_surfaces["ICONS.PCK"]->loadSpk(CrossPlatform::getDataFile(s.str()));
+	loader->addSpk(_surfaces["ICONS.PCK"], CrossPlatform::getDataFile(s.str()));
 
 	s.str("");
 	std::stringstream s2;
 	s << "UFOGRAPH/" << "CURSOR.PCK";
 	s2 << "UFOGRAPH/" << "CURSOR.TAB";
 	_sets["CURSOR.PCK"] = new SurfaceSet(32, 40);
-	_sets["CURSOR.PCK"]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+	loader->addPck(_sets["CURSOR.PCK"], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 
 	s.str("");
 	s2.str("");
 	s << "UFOGRAPH/" << "SMOKE.PCK";
 	s2 << "UFOGRAPH/" << "SMOKE.TAB";
 	_sets["SMOKE.PCK"] = new SurfaceSet(32, 40);
-	_sets["SMOKE.PCK"]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+	loader->addPck(_sets["SMOKE.PCK"], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 
 	s.str("");
 	s2.str("");
 	s << "UFOGRAPH/" << "X1.PCK";
 	s2 << "UFOGRAPH/" << "X1.TAB";
 	_sets["X1.PCK"] = new SurfaceSet(128, 64);
-	_sets["X1.PCK"]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+	loader->addPck(_sets["X1.PCK"], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 
 	s.str("");
 	s << "UFOGRAPH/" << "UNIBORD.PCK";
 	_surfaces["UNIBORD.PCK"] = new Surface(320, 200);
-	_surfaces["UNIBORD.PCK"]->loadSpk(CrossPlatform::getDataFile(s.str()));
+	loader->addSpk(_surfaces["UNIBORD.PCK"], CrossPlatform::getDataFile(s.str()));
 
 	s.str("");
 	_sets["MEDIBITS.DAT"] = new SurfaceSet(52, 58);
 	s << "UFOGRAPH/" << "MEDIBITS.DAT";
-	_sets["MEDIBITS.DAT"]->loadDat (CrossPlatform::getDataFile(s.str()));
+	loader->addDat(_sets["MEDIBITS.DAT"], CrossPlatform::getDataFile(s.str()));
 
 	s.str("");
 	_sets["DETBLOB.DAT"] = new SurfaceSet(16, 16);
 	s << "UFOGRAPH/" << "DETBLOB.DAT";
-	_sets["DETBLOB.DAT"]->loadDat (CrossPlatform::getDataFile(s.str()));
+	loader->addDat(_sets["DETBLOB.DAT"], CrossPlatform::getDataFile(s.str()));
 
 	s.str("");
 	s << "UFOGRAPH/" << "DETBORD.PCK";
 	_surfaces["DETBORD.PCK"] = new Surface(320, 200);
-	_surfaces["DETBORD.PCK"]->loadSpk(CrossPlatform::getDataFile(s.str()));
+	loader->addSpk(_surfaces["DETBORD.PCK"], CrossPlatform::getDataFile(s.str()));
 
 	s.str("");
 	s << "UFOGRAPH/" << "DETBORD2.PCK";
 	_surfaces["DETBORD2.PCK"] = new Surface(320, 200);
-	_surfaces["DETBORD2.PCK"]->loadSpk(CrossPlatform::getDataFile(s.str()));
+	loader->addSpk(_surfaces["DETBORD2.PCK"], CrossPlatform::getDataFile(s.str()));
 
 	// Load Battlescape Terrain (only blacks are loaded, others are loaded just in time)
 	std::string bsets[] = {"BLANKS.PCK"};
@@ -459,10 +494,10 @@ void XcomResourcePack::loadBattlescapeResources()
 		std::stringstream s2;
 		s2 << "TERRAIN/" << tab;
 		_sets[bsets[i]] = new SurfaceSet(32, 40);
-		_sets[bsets[i]]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+		loader->addPck(_sets[bsets[i]], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 	}
 
-	// Load Battlescape units
+	// Load Battlescape units (only when a battle needs them)
 	std::string usets[] = {"SILACOID.PCK",
 							"CELATID.PCK",
 							"HANDOB.PCK",
@@ -492,15 +527,14 @@ void XcomResourcePack::loadBattlescapeResources()
 		std::string tab = usets[i].substr(0, usets[i].length()-4) + ".TAB";
 		std::stringstream s2;
 		s2 << "UNITS/" << tab;
-		_sets[usets[i]] = new SurfaceSet(32, 40);
-		_sets[usets[i]]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+		addLazy(usets[i], LAZY_PCK, CrossPlatform::getDataFile(s.str()), 32, 40, false, CrossPlatform::getDataFile(s2.str()));
 	}
 	s.str("");
 	s << "UNITS/" << "BIGOBS.PCK";
 	s2.str("");
 	s2 << "UNITS/" << "BIGOBS.TAB";
 	_sets["BIGOBS.PCK"] = new SurfaceSet(32, 48);
-	_sets["BIGOBS.PCK"]->loadPck(CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
+	loader->addPck(_sets["BIGOBS.PCK"], CrossPlatform::getDataFile(s.str()), CrossPlatform::getDataFile(s2.str()));
 
 	s.str("");
 	s << "GEODATA/" << "LOFTEMPS.DAT";
@@ -513,7 +547,7 @@ void XcomResourcePack::loadBattlescapeResources()
 		std::stringstream s;
 		s << "UFOGRAPH/" << scrs[i];
 		_surfaces[scrs[i]] = new Surface(320, 200);
-		_surfaces[scrs[i]]->loadScr(CrossPlatform::getDataFile(s.str()));
+		loader->addScr(_surfaces[scrs[i]], CrossPlatform::getDataFile(s.str()));
 	}
 
 	std::string spks[] = {"TAC01.SCR",
@@ -540,8 +574,16 @@ void XcomResourcePack::loadBattlescapeResources()
 	{
 		std::stringstream s;
 		s << "UFOGRAPH/" << spks[i];
-		_surfaces[spks[i]] = new Surface(320, 200);
-		_surfaces[spks[i]]->loadSpk(CrossPlatform::getDataFile(s.str()));
+		if (spks[i] == "TAC01.SCR")
+		{
+			_surfaces[spks[i]] = new Surface(320, 200);
+			loader->addSpk(_surfaces[spks[i]], CrossPlatform::getDataFile(s.str()));
+		}
+		else
+		{
+			// Inventory soldier images are only loaded when viewed
+			addLazy(spks[i], LAZY_SPK, CrossPlatform::getDataFile(s.str()), 320, 200, true);
+		}
 	}
 }
 
@@ -24,6 +24,8 @@
 namespace OpenXcom
 {
 
+class ResourceLoader;
+
 /**
  * Resource pack for the X-Com: UFO Defense game.
  */
@@ -35,7 +37,7 @@ public:
 	/// Cleans up the X-Com ruleset.
 	~XcomResourcePack();
 	/// Loads battlescape specific resources
-	void loadBattlescapeResources();
+	void loadBattlescapeResources(ResourceLoader *loader);
 };
 
 }
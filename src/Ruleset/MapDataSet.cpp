@@ -18,11 +18,12 @@
  */
 #include "MapDataSet.h"
 #include "MapData.h"
-#include <fstream>
 #include <sstream>
+#include <cstring>
 #include "../Engine/Exception.h"
 #include "../Engine/SurfaceSet.h"
 #include "../Engine/CrossPlatform.h"
+#include "../Engine/AssetCache.h"
 #include "../Resource/ResourcePack.h"
 
 namespace OpenXcom
@@ -182,14 +183,21 @@ void MapDataSet::load(ResourcePack *res)
 	s << "TERRAIN/" << _name << ".MCD";
 
 	// Load file
-	std::ifstream mapFile (CrossPlatform::getDataFile(s.str()).c_str(), std::ios::in | std::ios::binary);
-	if (!mapFile)
+	size_t size = 0;
+	std::vector<Uint8> buffer;
+	const Uint8 *data = AssetCache::loadFile(CrossPlatform::getDataFile(s.str()), &size, &buffer);
+	if (data == 0)
 	{
 		throw Exception("Failed to load MCD");
 	}
+	if (size % sizeof(MCD) != 0)
+	{
+		throw Exception("Invalid data from file");
+	}
 
-	while (mapFile.read((char*)&mcd, sizeof(MCD)))
+	for (size_t offset = 0; offset + sizeof(MCD) <= size; offset += sizeof(MCD))
 	{
+		memcpy(&mcd, data + offset, sizeof(MCD));
 		MapData *to = new MapData(this);
 		_objects.push_back(to);
 
@@ -231,14 +239,6 @@ void MapDataSet::load(ResourcePack *res)
 		objNumber++;
 	}
 
-
-	if (!mapFile.eof())
-	{
-		throw Exception("Invalid data from file");
-	}
-
-	mapFile.close();
-
 	// process the mapdataset to put block values on floortiles (as we don't have em in UFO)
 	for (std::vector<MapData*>::iterator i = _objects.begin(); i != _objects.end(); ++i)
 	{
@@ -282,25 +282,16 @@ void MapDataSet::unload()
 void MapDataSet::loadLOFTEMPS(const std::string &filename, std::vector<Uint16> *voxelData)
 {
 	// Load file
-	std::ifstream mapFile (filename.c_str(), std::ios::in | std::ios::binary);
-	if (!mapFile)
+	size_t size = 0;
+	std::vector<Uint8> buffer;
+	const Uint8 *data = AssetCache::loadFile(filename, &size, &buffer);
+	if (data == 0)
 	{
 		throw Exception("Failed to load DAT");
 	}
 
-	Uint16 value;
-
-	while (mapFile.read((char*)&value, sizeof(value)))
-	{
-		voxelData->push_back(value);
-	}
-
-	if (!mapFile.eof())
-	{
-		throw Exception("Invalid data from file");
-	}
-
-	mapFile.close();
+	const Uint16 *values = (const Uint16*)data;
+	voxelData->insert(voxelData->end(), values, values + size / sizeof(Uint16));
 }
 
 MapData *MapDataSet::getBlankFloorTile()
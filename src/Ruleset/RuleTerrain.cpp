@@ -154,7 +154,7 @@ MapBlock* RuleTerrain::getRandomMapBlock(int maxsize, MapBlockType type)
 
 	if (compliantMapBlocks.size() == 0) return 0;
 
-	int n = RNG::generate(0, compliantMapBlocks.size() - 1);
+	int n = RNG::generate(RNG::STREAM_MAPGEN, 0, compliantMapBlocks.size() - 1);
 
 	return compliantMapBlocks[n];
 }
@@ -102,19 +102,19 @@ void SoldierNamePool::load(const std::string &filename)
 std::wstring SoldierNamePool::genName(int *gender) const
 {
 	std::wstringstream name;
-	unsigned int first = RNG::generate(1, _maleFirst.size() + _femaleFirst.size());
+	unsigned int first = RNG::generate(RNG::STREAM_GEOSCAPE, 1, _maleFirst.size() + _femaleFirst.size());
 	if (first <= _maleFirst.size())
 	{
 		*gender = 0;
 		name << _maleFirst[first - 1];
-		unsigned int last = RNG::generate(1, _maleLast.size());
+		unsigned int last = RNG::generate(RNG::STREAM_GEOSCAPE, 1, _maleLast.size());
 		name << " " << _maleLast[last - 1];
 	}
 	else
 	{
 		*gender = 1;
 		name << _femaleFirst[first - _maleFirst.size() - 1];
-		unsigned int last = RNG::generate(1, _femaleLast.size());
+		unsigned int last = RNG::generate(RNG::STREAM_GEOSCAPE, 1, _femaleLast.size());
 		name << " " << _femaleLast[last - 1];
 	}
 	return name.str();
@@ -41,7 +41,7 @@ namespace OpenXcom
  * @param unit Pointer to Unit object.
  * @param faction Which faction the units belongs to.
  */
-BattleUnit::BattleUnit(Unit *unit, UnitFaction faction) : _unit(unit), _faction(faction), _id(0), _pos(Position()), _tile(0), _lastPos(Position()), _direction(0), _directionTurret(0), _toDirectionTurret(0),  _verticalDirection(0), _status(STATUS_STANDING), _walkPhase(0), _fallPhase(0), _kneeled(false), _dontReselect(false), _fire(0), _currentAIState(0), _visible(false), _cacheInvalid(true), _expBravery(0), _expReactions(0), _expFiring(0), _expThrowing(0), _expPsiSkill(0), _expMelee(0), _turretType(-1), _motionPoints(0)
+BattleUnit::BattleUnit(Unit *unit, UnitFaction faction) : _unit(unit), _faction(faction), _id(0), _pos(Position()), _tile(0), _lastPos(Position()), _direction(0), _directionTurret(0), _toDirectionTurret(0),  _verticalDirection(0), _status(STATUS_STANDING), _walkPhase(0), _fallPhase(0), _kneeled(false), _dontReselect(false), _fire(0), _currentAIState(0), _visible(false), _cacheInvalid(true), _expBravery(0), _expReactions(0), _expFiring(0), _expThrowing(0), _expPsiSkill(0), _expMelee(0), _turretType(-1), _motionPoints(0), _fovCached(false), _fovPosition(Position()), _fovDirection(0)
 {
 	_tu = unit->getTimeUnits();
 	_energy = unit->getStamina();
@@ -64,8 +64,6 @@ BattleUnit::BattleUnit(Unit *unit, UnitFaction faction) : _unit(unit), _faction(
  */
 BattleUnit::~BattleUnit()
 {
-	for (int i = 0; i < 5; ++i)
-		delete _cache[i];
 }
 
 /**
@@ -531,7 +529,8 @@ UnitFaction BattleUnit::getFaction() const
 /**
  * Sets the unit's cache flag.
  * Set to true when the unit has to be redrawn from scratch.
- * @param cache
+ * @param cache Sprite from the map's unit sprite cache, which owns it (0 to invalidate).
+ * @param part Part of the unit.
  */
 void BattleUnit::setCache(Surface *cache, int part)
 {
@@ -745,8 +744,8 @@ void BattleUnit::damage(Position position, int power, ItemDamageType type)
 		if (_unit->isWoundable())
 		{
 			// fatal wounds
-			if (RNG::generate(0,damage) > 2)
-				_fatalWounds[bodypart] += RNG::generate(1,3);
+			if (RNG::generate(RNG::STREAM_COMBAT, 0,damage) > 2)
+				_fatalWounds[bodypart] += RNG::generate(RNG::STREAM_COMBAT, 1,3);
 
 			if (_fatalWounds[bodypart])
 				moraleChange(-_fatalWounds[bodypart]);
@@ -1074,7 +1073,7 @@ void BattleUnit::prepareNewTurn()
 	// suffer from fire
 	if (_fire > 0)
 	{
-		_health -= RNG::generate(5, 10);
+		_health -= RNG::generate(RNG::STREAM_COMBAT, 5, 10);
 		_fire--;
 	}
 
@@ -1096,9 +1095,9 @@ void BattleUnit::prepareNewTurn()
 	if (!isOut())
 	{
 		int chance = 100 - (2 * getMorale());
-		if (RNG::generate(1,100) <= chance)
+		if (RNG::generate(RNG::STREAM_COMBAT, 1,100) <= chance)
 		{
-			int type = RNG::generate(0,100);
+			int type = RNG::generate(RNG::STREAM_COMBAT, 0,100);
 			_status = (type<=33?STATUS_BERSERK:STATUS_PANICKING); // 33% chance of berserk, panic can mean freeze or flee, but that is determined later
 		}
 		else
@@ -1448,7 +1447,7 @@ bool BattleUnit::postMissionProcedures()
 
 	if (_expBravery && stats->bravery < 100)
 	{
-		if (_expBravery > RNG::generate(0,10)) stats->bravery += 10;
+		if (_expBravery > RNG::generate(RNG::STREAM_COMBAT, 0,10)) stats->bravery += 10;
 	}
 	if (_expReactions && stats->reactions < 100)
 	{
@@ -1479,13 +1478,13 @@ bool BattleUnit::postMissionProcedures()
 			s->promoteRank();
 		int v;
 		v = 80 - stats->tu;
-		if (v > 0) stats->tu += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->tu += RNG::generate(RNG::STREAM_COMBAT, 0, v/10 + 2);
 		v = 60 - stats->health;
-		if (v > 0) stats->health += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->health += RNG::generate(RNG::STREAM_COMBAT, 0, v/10 + 2);
 		v = 70 - stats->strength;
-		if (v > 0) stats->strength += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->strength += RNG::generate(RNG::STREAM_COMBAT, 0, v/10 + 2);
 		v = 100 - stats->stamina;
-		if (v > 0) stats->stamina += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->stamina += RNG::generate(RNG::STREAM_COMBAT, 0, v/10 + 2);
 		return true;
 	}
 	else
@@ -1505,7 +1504,7 @@ int BattleUnit::improveStat(int exp)
 	if (exp < 3) v = 1;
 	if (exp < 6) v = 2;
 	if (exp < 10) v = 3;
-	return (int)(v/2.0 + RNG::generate(0.0, v));
+	return (int)(v/2.0 + RNG::generate(RNG::STREAM_COMBAT, 0.0, v));
 }
 
 /*
@@ -1622,5 +1621,27 @@ int BattleUnit::getMotionPoints() const
 	return _motionPoints;
 }
 
+/**
+ * Checks if the tiles discovered by this unit's field of view are still up to date.
+ * This is only the case when the unit did not move or turn since the last
+ * calculation and no terrain changed within its view.
+ * @return true if the terrain field of view does not need to be recalculated.
+ */
+bool BattleUnit::getFovCached() const
+{
+	return _fovCached && _fovPosition == _pos && _fovDirection == _direction;
+}
+
+/**
+ * Marks the terrain field of view as calculated from the current position
+ * and direction, or invalidates it when terrain within view has changed.
+ * @param cached Whether the field of view is up to date.
+ */
+void BattleUnit::setFovCached(bool cached)
+{
+	_fovCached = cached;
+	_fovPosition = _pos;
+	_fovDirection = _direction;
 }
 
+}
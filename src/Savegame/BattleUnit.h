@@ -80,6 +80,9 @@ private:
 	int _turretType;
 	bool _needPainKiller;
 	int _motionPoints;
+	bool _fovCached;
+	Position _fovPosition;
+	int _fovDirection;
 public:
 	/// Creates a BattleUnit.
 	BattleUnit(Unit *_unit, UnitFaction faction);
@@ -259,6 +262,10 @@ public:
 	void stimulant (int energy, int stun);
 	/// Get motion points for the motion scanner.
 	int getMotionPoints() const;
+	/// Check if the terrain field of view is still valid.
+	bool getFovCached() const;
+	/// Mark the terrain field of view as (in)valid.
+	void setFovCached(bool cached);
 
 };
 
@@ -19,6 +19,7 @@
 #define _USE_MATH_DEFINES
 #include "MovingTarget.h"
 #include <cmath>
+#include <algorithm>
 
 namespace OpenXcom
 {
@@ -200,4 +201,55 @@ bool MovingTarget::reachedDestination() const
 	return (_lon == _dest->getLongitude() && _lat == _dest->getLatitude());
 }
 
+/**
+ * Returns how many steps of one axis can be taken
+ * without reaching the destination coordinate.
+ * @param pos Current coordinate.
+ * @param speed Coordinate change per step.
+ * @param dest Destination coordinate.
+ * @return Number of steps, 0 if the coordinate is already past the destination.
+ */
+static int quietAxisSteps(double pos, double speed, double dest)
+{
+	if ((speed > 0 && pos < dest) || (speed < 0 && pos > dest))
+	{
+		// Leave one step of margin for rounding errors
+		double steps = floor((dest - pos) / speed) - 1;
+		if (steps > MovingTarget::MAX_QUIET_STEPS)
+			return MovingTarget::MAX_QUIET_STEPS;
+		if (steps > 0)
+			return (int)steps;
+	}
+	return 0;
+}
+
+/**
+ * Returns how many 5-second steps the moving target can take along
+ * its current speed vector before finishedRoute() can become true,
+ * so the Geoscape can move it several steps at once.
+ * @return Number of steps, 0 if it could arrive on the next one.
+ */
+int MovingTarget::getQuietSteps() const
+{
+	if (_dest == 0 || (_speedLon == 0 && _speedLat == 0))
+	{
+		return MAX_QUIET_STEPS;
+	}
+	// The route is only finished once both coordinates are past the destination
+	int lonSteps = quietAxisSteps(_lon, _speedLon, _dest->getLongitude());
+	int latSteps = quietAxisSteps(_lat, _speedLat, _dest->getLatitude());
+	return std::max(lonSteps, latSteps);
+}
+
+/**
+ * Moves the moving target along its current speed vector
+ * for a number of 5-second steps at once.
+ * @param steps Number of steps.
+ */
+void MovingTarget::move(int steps)
+{
+	setLongitude(_lon + _speedLon * steps);
+	setLatitude(_lat + _speedLat * steps);
+}
+
 }
@@ -40,6 +40,7 @@ protected:
 	/// Calculates a new speed vector to the destination.
 	virtual void calculateSpeed();
 public:
+	static const int MAX_QUIET_STEPS = 17280;
 	/// Creates a moving target.
 	MovingTarget();
 	/// Cleans up the moving target.
@@ -62,6 +63,10 @@ public:
 	double getDistance(Target *target, double *dLon, double *dLat) const;
 	/// Has the moving target reached its destination?
 	bool reachedDestination() const;
+	/// Gets how many steps the moving target can take without finishing its route.
+	int getQuietSteps() const;
+	/// Moves the moving target a number of steps along its speed vector.
+	void move(int steps);
 };
 
 }
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SaveWriter.h"
+#include <cstdio>
+#include <fstream>
+#include "../Engine/CrossPlatform.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Initializes a writer with the contents of a save.
+ * The data is a finished snapshot of the game, so the
+ * game can carry on changing while it's written.
+ * @param filename Full path to the save.
+ * @param data Serialized save.
+ */
+SaveWriter::SaveWriter(const std::string &filename, const std::string &data) : _filename(filename), _data(data), _error(""), _thread(0), _mutex(0), _done(false), _success(false)
+{
+	_mutex = SDL_CreateMutex();
+}
+
+/**
+ * Waits for any pending write to finish.
+ */
+SaveWriter::~SaveWriter()
+{
+	wait();
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Entry point of the writer thread.
+ * @param writer Pointer to the writer.
+ * @return Zero if successful.
+ */
+int SaveWriter::run(void *writer)
+{
+	return ((SaveWriter*)writer)->write() ? 0 : -1;
+}
+
+/**
+ * Starts writing the save on a background thread.
+ * Falls back to writing it right away if the
+ * thread can't be created.
+ */
+void SaveWriter::start()
+{
+	if (_thread != 0)
+	{
+		return;
+	}
+	_thread = SDL_CreateThread(run, this);
+	if (_thread == 0)
+	{
+		write();
+	}
+}
+
+/**
+ * Writes the save to a temporary file next to it
+ * and then moves it over the old save.
+ * @return True if the save was written.
+ */
+bool SaveWriter::write()
+{
+	std::string tmp = _filename + ".tmp";
+	std::string error = "";
+	std::ofstream sav(tmp.c_str(), std::ios::out | std::ios::binary);
+	if (!sav)
+	{
+		error = "Failed to save savegame";
+	}
+	else
+	{
+		sav.write(_data.c_str(), _data.size());
+		sav.close();
+		if (sav.fail())
+		{
+			error = "Failed to write savegame";
+		}
+		else if (!CrossPlatform::moveFile(tmp, _filename))
+		{
+			error = "Failed to replace savegame";
+		}
+	}
+	if (!error.empty())
+	{
+		remove(tmp.c_str());
+	}
+
+	SDL_LockMutex(_mutex);
+	_error = error;
+	_success = error.empty();
+	_done = true;
+	SDL_UnlockMutex(_mutex);
+	return _success;
+}
+
+/**
+ * Returns whether the save has been written yet,
+ * for polling from the game loop.
+ * @return True if the writing is over.
+ */
+bool SaveWriter::isDone()
+{
+	SDL_LockMutex(_mutex);
+	bool done = _done;
+	SDL_UnlockMutex(_mutex);
+	return done;
+}
+
+/**
+ * Blocks until the background thread is done.
+ * @return True if the save was written.
+ */
+bool SaveWriter::wait()
+{
+	if (_thread != 0)
+	{
+		SDL_WaitThread(_thread, 0);
+		_thread = 0;
+	}
+	SDL_LockMutex(_mutex);
+	bool success = _success;
+	SDL_UnlockMutex(_mutex);
+	return success;
+}
+
+/**
+ * Returns the reason the save couldn't be written.
+ * @return Error message, or empty if there was none.
+ */
+std::string SaveWriter::getError()
+{
+	SDL_LockMutex(_mutex);
+	std::string error = _error;
+	SDL_UnlockMutex(_mutex);
+	return error;
+}
+
+}
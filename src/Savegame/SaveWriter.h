@@ -0,0 +1,64 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SAVEWRITER_H
+#define OPENXCOM_SAVEWRITER_H
+
+#include <string>
+#include "SDL.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Writes a serialized save to disk, optionally on a
+ * background thread so the game doesn't stop while it's
+ * written. The save is first written to a temporary file
+ * which then replaces the real one, so a crash halfway
+ * through never leaves a corrupted save behind.
+ */
+class SaveWriter
+{
+private:
+	std::string _filename, _data, _error;
+	SDL_Thread *_thread;
+	SDL_mutex *_mutex;
+	bool _done, _success;
+
+	/// Runs the writer on its thread.
+	static int run(void *writer);
+public:
+	/// Creates a writer for a save.
+	SaveWriter(const std::string &filename, const std::string &data);
+	/// Cleans up the writer.
+	~SaveWriter();
+	/// Starts writing on a background thread.
+	void start();
+	/// Writes the save right away.
+	bool write();
+	/// Checks if the writing is over.
+	bool isDone();
+	/// Waits for the writing to be over.
+	bool wait();
+	/// Gets the error of a failed write.
+	std::string getError();
+};
+
+}
+
+#endif
@@ -36,16 +36,100 @@
 #include "../Battlescape/PatrolBAIState.h"
 #include "../Battlescape/AggroBAIState.h"
 #include "../Engine/RNG.h"
+#include "../Engine/Options.h"
+#include "../Engine/Exception.h"
 #include "../Savegame/NodeLink.h"
 
 
 namespace OpenXcom
 {
 
+/// Version of the binary tile data, bumped whenever its layout changes.
+static const int TILE_DATA_VERSION = 1;
+static const int TILE_DATA_HEADER = 11;
+static const char *BASE64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * Encodes binary data as base64 text, so it can be
+ * stored as a single YAML scalar.
+ * @param data Binary data.
+ * @return Encoded text.
+ */
+static std::string encodeBase64(const std::vector<Uint8> &data)
+{
+	std::string out;
+	out.reserve((data.size() + 2) / 3 * 4);
+	for (size_t i = 0; i < data.size(); i += 3)
+	{
+		Uint32 n = data[i] << 16;
+		if (i + 1 < data.size()) n |= data[i + 1] << 8;
+		if (i + 2 < data.size()) n |= data[i + 2];
+		out += BASE64[(n >> 18) & 63];
+		out += BASE64[(n >> 12) & 63];
+		out += (i + 1 < data.size()) ? BASE64[(n >> 6) & 63] : '=';
+		out += (i + 2 < data.size()) ? BASE64[n & 63] : '=';
+	}
+	return out;
+}
+
+/**
+ * Decodes base64 text back into binary data.
+ * Characters outside the base64 alphabet are skipped.
+ * @param text Encoded text.
+ * @param data Vector to store the binary data.
+ */
+static void decodeBase64(const std::string &text, std::vector<Uint8> &data)
+{
+	int lookup[256];
+	std::fill(lookup, lookup + 256, -1);
+	for (int i = 0; i < 64; ++i)
+	{
+		lookup[(Uint8)BASE64[i]] = i;
+	}
+	data.clear();
+	data.reserve(text.size() / 4 * 3);
+	Uint32 n = 0;
+	int bits = 0;
+	for (std::string::const_iterator i = text.begin(); i != text.end(); ++i)
+	{
+		int v = lookup[(Uint8)*i];
+		if (v == -1)
+			continue;
+		n = (n << 6) | v;
+		bits += 6;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			data.push_back((Uint8)((n >> bits) & 0xFF));
+		}
+	}
+}
+
+/**
+ * Writes a little-endian 16-bit number to a buffer.
+ * @param buffer Pointer to the buffer.
+ * @param value Number to write.
+ */
+static void writeUint16(Uint8 *buffer, int value)
+{
+	buffer[0] = (Uint8)(value & 0xFF);
+	buffer[1] = (Uint8)((value >> 8) & 0xFF);
+}
+
+/**
+ * Reads a little-endian 16-bit number from a buffer.
+ * @param buffer Pointer to the buffer.
+ * @return Number read.
+ */
+static int readUint16(const Uint8 *buffer)
+{
+	return buffer[0] | (buffer[1] << 8);
+}
+
 /**
  * Initializes a brand new battlescape saved game.
  */
-SavedBattleGame::SavedBattleGame() : _tiles(), _selectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0)
+SavedBattleGame::SavedBattleGame() : _tiles(), _selectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0), _bucketColumns(0), _bucketRows(0), _unitBuckets(), _unitBucket()
 {
 }
 
@@ -104,13 +188,22 @@ void SavedBattleGame::load(const YAML::Node &node, Ruleset *rule, SavedGame* sav
 
 	initMap(_width, _length, _height);
 
-	for (YAML::Iterator i = node["tiles"].begin(); i != node["tiles"].end(); ++i)
+	if (const YAML::Node *pName = node.FindValue("tileData"))
 	{
-		Position pos;
-		(*i)["position"][0] >> pos.x;
-		(*i)["position"][1] >> pos.y;
-		(*i)["position"][2] >> pos.z;
-		getTile(pos)->load((*i));
+		std::string text;
+		*pName >> text;
+		loadTileData(text);
+	}
+	else
+	{
+		for (YAML::Iterator i = node["tiles"].begin(); i != node["tiles"].end(); ++i)
+		{
+			Position pos;
+			(*i)["position"][0] >> pos.x;
+			(*i)["position"][1] >> pos.y;
+			(*i)["position"][2] >> pos.z;
+			getTile(pos)->load((*i));
+		}
 	}
 
 	for (YAML::Iterator i = node["nodes"].begin(); i != node["nodes"].end(); ++i)
@@ -259,6 +352,7 @@ void SavedBattleGame::loadMapResources(ResourcePack *res)
 	}
 
 	initUtilities(res);
+	getTileEngine()->calculateTerrainVoxels();
 	getTileEngine()->calculateSunShading();
 	getTileEngine()->calculateTerrainLighting();
 	getTileEngine()->calculateUnitLighting();
@@ -290,16 +384,23 @@ void SavedBattleGame::save(YAML::Emitter &out) const
 	}
 	out << YAML::EndSeq;
 
-	out << YAML::Key << "tiles" << YAML::Value;
-	out << YAML::BeginSeq;
-	for (int i = 0; i < _height * _length * _width; ++i)
+	if (Options::getBool("battleBinarySave"))
 	{
-		if (!_tiles[i]->isVoid())
+		out << YAML::Key << "tileData" << YAML::Value << saveTileData();
+	}
+	else
+	{
+		out << YAML::Key << "tiles" << YAML::Value;
+		out << YAML::BeginSeq;
+		for (int i = 0; i < _height * _length * _width; ++i)
 		{
-			_tiles[i]->save(out);
+			if (!_tiles[i]->isVoid())
+			{
+				_tiles[i]->save(out);
+			}
 		}
+		out << YAML::EndSeq;
 	}
-	out << YAML::EndSeq;
 
 	out << YAML::Key << "nodes" << YAML::Value;
 	out << YAML::BeginSeq;
@@ -328,6 +429,61 @@ void SavedBattleGame::save(YAML::Emitter &out) const
 	out << YAML::EndMap;
 }
 
+/**
+ * Loads all the tiles from a block of binary tile data
+ * in one pass, instead of a YAML node per tile.
+ * @param text Base64 encoded tile data.
+ */
+void SavedBattleGame::loadTileData(const std::string &text)
+{
+	std::vector<Uint8> data;
+	decodeBase64(text, data);
+	int size = _height * _length * _width;
+	if (data.size() < (size_t)TILE_DATA_HEADER || data[0] != 'O' || data[1] != 'X' || data[2] != 'B' || data[3] != 'T')
+	{
+		throw Exception("Invalid battlescape tile data");
+	}
+	if (readUint16(&data[4]) != TILE_DATA_VERSION)
+	{
+		throw Exception("Unsupported battlescape tile data version");
+	}
+	if (readUint16(&data[6]) != _width || readUint16(&data[8]) != _length || data[10] != _height || data.size() != (size_t)(TILE_DATA_HEADER + size * Tile::BINARY_SIZE))
+	{
+		throw Exception("Battlescape tile data doesn't match the map size");
+	}
+	const Uint8 *buffer = &data[TILE_DATA_HEADER];
+	for (int i = 0; i < size; ++i, buffer += Tile::BINARY_SIZE)
+	{
+		_tiles[i]->loadBinary(buffer);
+	}
+}
+
+/**
+ * Saves all the tiles into a block of binary tile data:
+ * a versioned little-endian header with the map size,
+ * followed by every tile in index order.
+ * @return Base64 encoded tile data.
+ */
+std::string SavedBattleGame::saveTileData() const
+{
+	int size = _height * _length * _width;
+	std::vector<Uint8> data(TILE_DATA_HEADER + size * Tile::BINARY_SIZE);
+	data[0] = 'O';
+	data[1] = 'X';
+	data[2] = 'B';
+	data[3] = 'T';
+	writeUint16(&data[4], TILE_DATA_VERSION);
+	writeUint16(&data[6], _width);
+	writeUint16(&data[8], _length);
+	data[10] = (Uint8)_height;
+	Uint8 *buffer = &data[TILE_DATA_HEADER];
+	for (int i = 0; i < size; ++i, buffer += Tile::BINARY_SIZE)
+	{
+		_tiles[i]->saveBinary(buffer);
+	}
+	return encodeBase64(data);
+}
+
 /**
  * Gets a pointer to the array of tiles.
  * @return A pointer to Tile array.
@@ -357,6 +513,12 @@ void SavedBattleGame::initMap(int width, int length, int height)
 		_tiles[i] = new Tile(pos);
 	}
 
+	// units are kept in a grid of buckets per faction for proximity queries
+	_bucketColumns = (_width + UNIT_BUCKET_SIZE - 1) / UNIT_BUCKET_SIZE;
+	_bucketRows = (_length + UNIT_BUCKET_SIZE - 1) / UNIT_BUCKET_SIZE;
+	_unitBuckets.clear();
+	_unitBuckets.resize((FACTION_NEUTRAL + 1) * _bucketRows * _bucketColumns);
+	_unitBucket.clear();
 }
 
 /**
@@ -700,6 +862,8 @@ void SavedBattleGame::endTurn()
 	{
 		prepareNewTurn();
 		_turn++;
+		// fire and smoke may have changed the terrain
+		_pathfinding->invalidateReachable();
 		_side = FACTION_PLAYER;
 		if (_lastSelectedUnit && !_lastSelectedUnit->isOut())
 			_selectedUnit = _lastSelectedUnit;
@@ -772,6 +936,10 @@ void SavedBattleGame::resetUnitTiles()
 			(*i)->setVisible(true);
 		}
 	}
+	if (_pathfinding)
+	{
+		_pathfinding->invalidateReachable();
+	}
 }
 
 /**
@@ -866,7 +1034,7 @@ Node *SavedBattleGame::getSpawnNode(int nodeRank, BattleUnit *unit)
 	
 	if (compliantNodes.size() == 0) return 0;
 
-	int n = RNG::generate(0, compliantNodes.size() - 1);
+	int n = RNG::generate(RNG::STREAM_AI, 0, compliantNodes.size() - 1);
 
 	return compliantNodes[n];
 }
@@ -901,7 +1069,7 @@ Node *SavedBattleGame::getPatrolNode(bool scout, BattleUnit *unit, Node *fromNod
 
 	if (compliantNodes.size() == 0) return 0;
 
-	return compliantNodes[RNG::generate(0, compliantNodes.size() - 1)];
+	return compliantNodes[RNG::generate(RNG::STREAM_AI, 0, compliantNodes.size() - 1)];
 }
 
 /**
@@ -926,8 +1094,8 @@ void SavedBattleGame::prepareNewTurn()
 	}
 
 	// smoke spreads in 1 random direction, but the direction is same for all smoke
-	int spreadX = RNG::generate(-1, +1);
-	int spreadY = RNG::generate(-1, +1);
+	int spreadX = RNG::generate(RNG::STREAM_COMBAT, -1, +1);
+	int spreadY = RNG::generate(RNG::STREAM_COMBAT, -1, +1);
 	for (std::vector<Tile*>::iterator i = tilesOnSmoke.begin(); i != tilesOnSmoke.end(); ++i)
 	{
 		int x = (*i)->getPosition().x;
@@ -959,6 +1127,8 @@ void SavedBattleGame::prepareNewTurn()
 		}
 
 		(*i)->prepareNewTurn();
+		// a tile that is on fire as well may burn down here
+		getTileEngine()->updateTerrainVoxels(*i);
 	}
 
 	for (std::vector<Tile*>::iterator i = tilesOnFire.begin(); i != tilesOnFire.end(); ++i)
@@ -966,11 +1136,11 @@ void SavedBattleGame::prepareNewTurn()
 		if ((*i)->getUnit())
 		{
 			// units on a flaming tile suffer damage
-			(*i)->getUnit()->damage(Position(0,0,0), RNG::generate(1,12), DT_IN);
+			(*i)->getUnit()->damage(Position(0,0,0), RNG::generate(RNG::STREAM_COMBAT, 1,12), DT_IN);
 			// units on a flaming tile can catch fire 33% chance
-			if (RNG::generate(0,2) == 1)
+			if (RNG::generate(RNG::STREAM_COMBAT, 0,2) == 1)
 			{
-				(*i)->getUnit()->setFire(RNG::generate(1,5));
+				(*i)->getUnit()->setFire(RNG::generate(RNG::STREAM_COMBAT, 1,5));
 			}
 		}
 
@@ -988,12 +1158,12 @@ void SavedBattleGame::prepareNewTurn()
 						int flam = t->getFlammability();
 						if (flam < 255)
 						{
-							double base = RNG::boxMuller(0,126);
+							double base = RNG::boxMuller(RNG::STREAM_COMBAT, 0,126);
 							if (base < 0) base *= -1;
 
 							if (flam < base)
 							{
-								if (RNG::generate(0, flam) < 2)
+								if (RNG::generate(RNG::STREAM_COMBAT, 0, flam) < 2)
 								{
 									t->ignite();
 								}
@@ -1004,6 +1174,8 @@ void SavedBattleGame::prepareNewTurn()
 			}
 		}
 		(*i)->prepareNewTurn();
+		// burned objects are destroyed
+		getTileEngine()->updateTerrainVoxels(*i);
 	}
 
 	if (!tilesOnFire.empty())
@@ -1034,7 +1206,9 @@ void SavedBattleGame::reviveUnconsciousUnits()
 			{
 				// recover from unconscious
 				(*i)->setPosition(originalPosition + Position(xd[dir],yd[dir],0));
+				updateUnitGrid(*i);
 				getTile(originalPosition + Position(xd[dir],yd[dir],0))->setUnit(*i);
+				_pathfinding->invalidateReachable();
 				(*i)->turn(false); // makes the unit stand up again
 				(*i)->setCache(0);
 				getTileEngine()->calculateFOV((*i));
@@ -1094,8 +1268,127 @@ bool SavedBattleGame::setUnitPosition(BattleUnit *bu, const Position &position,
 			getTile(position + Position(x,y,0))->setUnit(bu);
 		}
 	}
+	updateUnitGrid(bu);
+	if (_pathfinding)
+	{
+		_pathfinding->invalidateReachable();
+	}
 
 	return true;
 }
 
+/**
+ * Orders units by ID, which is the order they were added to the battle in.
+ * @param a First unit.
+ * @param b Second unit.
+ * @return True if the first unit goes first.
+ */
+static bool compareUnitIds(BattleUnit *a, BattleUnit *b)
+{
+	return a->getId() < b->getId();
+}
+
+/**
+ * Returns the bucket of the unit grid a unit belongs in,
+ * going by its faction and the tile it's standing on.
+ * @param unit Pointer to the unit.
+ * @return Bucket index.
+ */
+int SavedBattleGame::getUnitBucket(BattleUnit *unit) const
+{
+	int x = std::max(0, std::min(_bucketColumns - 1, unit->getPosition().x / UNIT_BUCKET_SIZE));
+	int y = std::max(0, std::min(_bucketRows - 1, unit->getPosition().y / UNIT_BUCKET_SIZE));
+	return (unit->getFaction() * _bucketRows + y) * _bucketColumns + x;
+}
+
+/**
+ * Adds the units that aren't in the unit grid yet, such as
+ * units that were loaded or never placed on the map.
+ * Units never leave the battle, so it's enough to check
+ * if the grid has as many units as the battle.
+ */
+void SavedBattleGame::indexUnits()
+{
+	if (_unitBucket.size() == _units.size())
+	{
+		return;
+	}
+	for (std::vector<BattleUnit*>::iterator i = _units.begin(); i != _units.end(); ++i)
+	{
+		if (_unitBucket.find(*i) == _unitBucket.end())
+		{
+			updateUnitGrid(*i);
+		}
+	}
+}
+
+/**
+ * Files a unit under the bucket of the unit grid for its
+ * current position and faction. Has to be called whenever
+ * a unit moves to another tile.
+ * @param unit Pointer to the unit.
+ */
+void SavedBattleGame::updateUnitGrid(BattleUnit *unit)
+{
+	if (_unitBuckets.empty())
+	{
+		return;
+	}
+	int bucket = getUnitBucket(unit);
+	std::map<BattleUnit*, int>::iterator i = _unitBucket.find(unit);
+	if (i != _unitBucket.end())
+	{
+		if (i->second == bucket)
+		{
+			return;
+		}
+		std::vector<BattleUnit*> &old = _unitBuckets[i->second];
+		old.erase(std::find(old.begin(), old.end(), unit));
+		i->second = bucket;
+	}
+	else
+	{
+		_unitBucket[unit] = bucket;
+	}
+	_unitBuckets[bucket].push_back(unit);
+}
+
+/**
+ * Adds the units of a faction standing within a certain number
+ * of tiles of a position, on any level, to a list. Only the
+ * buckets of the unit grid around the position are searched.
+ * The list is kept in the same order as the units in the battle.
+ * @param center Position to search around.
+ * @param range Maximum distance in tiles along each axis.
+ * @param faction Faction of the units to find.
+ * @param units List to add the units to.
+ */
+void SavedBattleGame::getUnitsInRange(const Position &center, int range, UnitFaction faction, std::vector<BattleUnit*> *units)
+{
+	indexUnits();
+	if (_unitBuckets.empty())
+	{
+		return;
+	}
+	int minX = std::max(0, (center.x - range) / UNIT_BUCKET_SIZE);
+	int maxX = std::min(_bucketColumns - 1, (center.x + range) / UNIT_BUCKET_SIZE);
+	int minY = std::max(0, (center.y - range) / UNIT_BUCKET_SIZE);
+	int maxY = std::min(_bucketRows - 1, (center.y + range) / UNIT_BUCKET_SIZE);
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			std::vector<BattleUnit*> &bucket = _unitBuckets[(faction * _bucketRows + y) * _bucketColumns + x];
+			for (std::vector<BattleUnit*>::iterator i = bucket.begin(); i != bucket.end(); ++i)
+			{
+				if (abs((*i)->getPosition().x - center.x) <= range && abs((*i)->getPosition().y - center.y) <= range)
+				{
+					units->push_back(*i);
+				}
+			}
+		}
+	}
+	std::sort(units->begin(), units->end(), compareUnitIds);
+}
+
 }
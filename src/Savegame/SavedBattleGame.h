@@ -22,6 +22,7 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
+#include <map>
 #include <string>
 #include "yaml.h"
 #include "BattleItem.h"
@@ -71,6 +72,18 @@ private:
 	bool _debugMode;
 	bool _aborted;
 	int _itemId;
+	static const int UNIT_BUCKET_SIZE = 8;
+	int _bucketColumns, _bucketRows;
+	std::vector< std::vector<BattleUnit*> > _unitBuckets;
+	std::map<BattleUnit*, int> _unitBucket;
+	/// Gets the bucket of the unit grid a unit belongs in.
+	int getUnitBucket(BattleUnit *unit) const;
+	/// Adds any units missing from the unit grid.
+	void indexUnits();
+	/// Loads the tiles from binary tile data.
+	void loadTileData(const std::string &text);
+	/// Saves the tiles to binary tile data.
+	std::string saveTileData() const;
 public:
 	/// Creates a new battle save, based on current generic save.
 	SavedBattleGame();
@@ -164,6 +177,10 @@ public:
 	void removeUnconsciousBodyItem(BattleUnit *bu);
 	/// Set or try to set a unit of a certain size on a certain position of the map.
 	bool setUnitPosition(BattleUnit *bu, const Position &position, bool testOnly = false);
+	/// Moves a unit to the right bucket of the unit grid.
+	void updateUnitGrid(BattleUnit *unit);
+	/// Gets the units of a faction near a position.
+	void getUnitsInRange(const Position &center, int range, UnitFaction faction, std::vector<BattleUnit*> *units);
 };
 
 }
@@ -29,6 +29,7 @@
 #include "../Engine/Options.h"
 #include "../Engine/CrossPlatform.h"
 #include "SavedBattleGame.h"
+#include "SaveWriter.h"
 #include "GameTime.h"
 #include "Country.h"
 #include "Base.h"
@@ -121,33 +122,166 @@ SavedGame::~SavedGame()
 	delete _ufopaedia;
 }
 
+/**
+ * Cached brief info of a save, valid as long as the
+ * file keeps the same modification time and size.
+ */
+struct SaveIndexEntry
+{
+	time_t modified;
+	long size;
+	GameTime time;
+	SaveIndexEntry(time_t modified_, long size_, const GameTime &time_) : modified(modified_), size(size_), time(time_) {};
+};
+
+/**
+ * Reads just the brief info of a save, which is the first
+ * YAML document in the file, without parsing the rest.
+ * @param filename Full path to the save.
+ * @param time Game time to load the save time into.
+ */
+static void loadBriefInfo(const std::string &filename, GameTime *time)
+{
+	std::ifstream fin(filename.c_str());
+	if (!fin)
+	{
+		throw Exception("Failed to load savegame");
+	}
+	std::string header, line;
+	bool content = false;
+	while (std::getline(fin, line))
+	{
+		if (line.compare(0, 3, "---") == 0)
+		{
+			if (content)
+				break;
+		}
+		else
+		{
+			content = true;
+		}
+		header += line + "\n";
+	}
+	fin.close();
+
+	std::istringstream ss(header);
+	YAML::Parser parser(ss);
+	YAML::Node doc;
+	parser.GetNextDocument(doc);
+	time->load(doc["time"]);
+}
+
+/**
+ * Loads the index of saves, which caches the brief
+ * info of every save so they don't need to be opened.
+ * A missing or broken index is just treated as empty.
+ * @param index Map to store the index entries.
+ */
+static void loadIndex(std::map<std::string, SaveIndexEntry> *index)
+{
+	std::string s = Options::getUserFolder() + "saves.idx";
+	std::ifstream fin(s.c_str());
+	if (!fin)
+	{
+		return;
+	}
+	try
+	{
+		YAML::Parser parser(fin);
+		YAML::Node doc;
+		parser.GetNextDocument(doc);
+		for (YAML::Iterator i = doc.begin(); i != doc.end(); ++i)
+		{
+			std::string file;
+			long modified, size;
+			GameTime time = GameTime(6, 1, 1, 1999, 12, 0, 0);
+			(*i)["file"] >> file;
+			(*i)["modified"] >> modified;
+			(*i)["size"] >> size;
+			time.load((*i)["time"]);
+			index->insert(std::make_pair(file, SaveIndexEntry((time_t)modified, size, time)));
+		}
+	}
+	catch (YAML::Exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		index->clear();
+	}
+	fin.close();
+}
+
+/**
+ * Saves the index of saves.
+ * @param index Map of index entries.
+ */
+static void saveIndex(const std::map<std::string, SaveIndexEntry> &index)
+{
+	std::string s = Options::getUserFolder() + "saves.idx";
+	std::ofstream sav(s.c_str());
+	if (!sav)
+	{
+		std::cerr << "Failed to save index of saves" << std::endl;
+		return;
+	}
+	YAML::Emitter out;
+	out << YAML::BeginSeq;
+	for (std::map<std::string, SaveIndexEntry>::const_iterator i = index.begin(); i != index.end(); ++i)
+	{
+		out << YAML::BeginMap;
+		out << YAML::Key << "file" << YAML::Value << i->first;
+		out << YAML::Key << "modified" << YAML::Value << (long)i->second.modified;
+		out << YAML::Key << "size" << YAML::Value << i->second.size;
+		out << YAML::Key << "time" << YAML::Value;
+		i->second.time.save(out);
+		out << YAML::EndMap;
+	}
+	out << YAML::EndSeq;
+	sav << out.c_str();
+	sav.close();
+}
+
 /**
  * Gets all the saves found in the user folder
  * and adds them to a text list.
+ * The brief info of each save is taken from the index
+ * of saves when the file hasn't changed since it was
+ * indexed, otherwise it's read from the save and the
+ * index is updated.
  * @param list Text list.
  * @param lang Loaded language.
  */
 void SavedGame::getList(TextList *list, Language *lang)
 {
 	std::vector<std::string> saves = CrossPlatform::getFolderContents(Options::getUserFolder(), "sav");
+	std::map<std::string, SaveIndexEntry> index, newIndex;
+	loadIndex(&index);
+	bool changed = false;
 
 	for (std::vector<std::string>::iterator i = saves.begin(); i != saves.end(); ++i)
 	{
 		std::string file = (*i);
 		std::string fullname = Options::getUserFolder() + file;
-		std::ifstream fin(fullname.c_str());
 		try
 		{
-			if (!fin)
+			time_t modified = 0;
+			long size = 0;
+			if (!CrossPlatform::getFileInfo(fullname, &modified, &size))
 			{
 				throw Exception("Failed to load savegame");
 			}
-			YAML::Parser parser(fin);
-			YAML::Node doc;
-
-			parser.GetNextDocument(doc);
 			GameTime time = GameTime(6, 1, 1, 1999, 12, 0, 0);
-			time.load(doc["time"]);
+			std::map<std::string, SaveIndexEntry>::iterator entry = index.find(file);
+			if (entry != index.end() && entry->second.modified == modified && entry->second.size == size)
+			{
+				time = entry->second.time;
+			}
+			else
+			{
+				loadBriefInfo(fullname, &time);
+				changed = true;
+			}
+			newIndex.insert(std::make_pair(file, SaveIndexEntry(modified, size, time)));
+
 			std::stringstream saveTime;
 			std::wstringstream saveDay, saveMonth, saveYear;
 			saveTime << time.getHour() << ":" << std::setfill('0') << std::setw(2) << time.getMinute();
@@ -155,7 +289,6 @@ void SavedGame::getList(TextList *list, Language *lang)
 			saveMonth << lang->getString(time.getMonthString());
 			saveYear << time.getYear();
 			list->addRow(5, Language::utf8ToWstr(file.substr(0, file.length()-4)).c_str(), Language::utf8ToWstr(saveTime.str()).c_str(), saveDay.str().c_str(), saveMonth.str().c_str(), saveYear.str().c_str());
-			fin.close();
 		}
 		catch (Exception &e)
 		{
@@ -168,6 +301,11 @@ void SavedGame::getList(TextList *list, Language *lang)
 			continue;
 		}
 	}
+
+	if (changed || newIndex.size() != index.size())
+	{
+		saveIndex(newIndex);
+	}
 }
 
 /**
@@ -264,6 +402,11 @@ void SavedGame::load(const std::string &filename, Ruleset *rule)
 		_battleGame->load(*pName, rule, this);
 	}
 
+	if (const YAML::Node *pName = doc.FindValue("rng"))
+	{
+		RNG::load(*pName);
+	}
+
 	fin.close();
 }
 
@@ -273,13 +416,33 @@ void SavedGame::load(const std::string &filename, Ruleset *rule)
  */
 void SavedGame::save(const std::string &filename) const
 {
-	std::string s = Options::getUserFolder() + filename + ".sav";
-	std::ofstream sav(s.c_str());
-	if (!sav)
+	SaveWriter writer(Options::getUserFolder() + filename + ".sav", serialize());
+	if (!writer.write())
 	{
-		throw Exception("Failed to save savegame");
+		throw Exception(writer.getError());
 	}
+}
 
+/**
+ * Saves a saved game's contents to a YAML file in the background.
+ * The game is serialized right away, so it can keep changing
+ * while the file is written.
+ * @param filename YAML filename.
+ * @return Pointer to the writer, to poll for completion. Delete it once it's done.
+ */
+SaveWriter *SavedGame::saveAsync(const std::string &filename) const
+{
+	SaveWriter *writer = new SaveWriter(Options::getUserFolder() + filename + ".sav", serialize());
+	writer->start();
+	return writer;
+}
+
+/**
+ * Serializes a saved game's contents to YAML.
+ * @return YAML text.
+ */
+std::string SavedGame::serialize() const
+{
 	YAML::Emitter out;
 
 	// Saves the brief game info used in the saves list
@@ -346,9 +509,10 @@ void SavedGame::save(const std::string &filename) const
 		out << YAML::Key << "battleGame" << YAML::Value;
 		_battleGame->save(out);
 	}
+	out << YAML::Key << "rng" << YAML::Value;
+	RNG::save(out);
 	out << YAML::EndMap;
-	sav << out.c_str();
-	sav.close();
+	return out.c_str();
 }
 
 /**
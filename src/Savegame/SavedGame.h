@@ -41,6 +41,7 @@ class RuleResearchProject;
 class ResearchProject;
 class Soldier;
 class RuleManufactureInfo;
+class SaveWriter;
 
 /**
  * Enumator containing all the possible game difficulties.
@@ -72,6 +73,8 @@ private:
 	/// Check whether a ResearchProject can be researched
 	bool isResearchAvailable (RuleResearchProject * r, const std::vector<const RuleResearchProject *> & unlockeds) const;
 	void getDependableResearchBasic (std::vector<RuleResearchProject *> & dependables, const RuleResearchProject *research, Ruleset * ruleset, Base * base) const;
+	/// Serializes a saved game to YAML.
+	std::string serialize() const;
 public:
 	/// Creates a new save with a certain difficulty.
 	SavedGame(GameDifficulty difficulty);
@@ -83,6 +86,8 @@ public:
 	void load(const std::string &filename, Ruleset *rule);
 	/// Saves a saved game to YAML.
 	void save(const std::string &filename) const;
+	/// Saves a saved game to YAML in the background.
+	SaveWriter *saveAsync(const std::string &filename) const;
 	/// Gets the current funds.
 	int getFunds() const;
 	/// Sets new funds.
@@ -60,24 +60,24 @@ Soldier::Soldier(RuleSoldier *rules, RuleArmor *armor, const std::vector<Soldier
 	UnitStats minStats = rules->getMinStats();
 	UnitStats maxStats = rules->getMaxStats();
 
-	_initialStats.tu = RNG::generate(minStats.tu, maxStats.tu);
-	_initialStats.stamina = RNG::generate(minStats.stamina, maxStats.stamina);
-	_initialStats.health = RNG::generate(minStats.health, maxStats.health);
-	_initialStats.bravery = RNG::generate(minStats.bravery, maxStats.bravery);
-	_initialStats.reactions = RNG::generate(minStats.reactions, maxStats.reactions);
-	_initialStats.firing = RNG::generate(minStats.firing, maxStats.firing);
-	_initialStats.throwing = RNG::generate(minStats.throwing, maxStats.throwing);
-	_initialStats.strength = RNG::generate(minStats.strength, maxStats.strength);
-	_initialStats.psiStrength = RNG::generate(minStats.psiStrength, maxStats.psiStrength);
-	_initialStats.melee = RNG::generate(minStats.melee, maxStats.melee);
+	_initialStats.tu = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.tu, maxStats.tu);
+	_initialStats.stamina = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.stamina, maxStats.stamina);
+	_initialStats.health = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.health, maxStats.health);
+	_initialStats.bravery = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.bravery, maxStats.bravery);
+	_initialStats.reactions = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.reactions, maxStats.reactions);
+	_initialStats.firing = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.firing, maxStats.firing);
+	_initialStats.throwing = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.throwing, maxStats.throwing);
+	_initialStats.strength = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.strength, maxStats.strength);
+	_initialStats.psiStrength = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.psiStrength, maxStats.psiStrength);
+	_initialStats.melee = RNG::generate(RNG::STREAM_GEOSCAPE, minStats.melee, maxStats.melee);
 	_initialStats.psiSkill = 0;
 
 	_currentStats = _initialStats;
 
 	int gender;
-	_name = names->at(RNG::generate(0, names->size()-1))->genName(&gender);
+	_name = names->at(RNG::generate(RNG::STREAM_GEOSCAPE, 0, names->size()-1))->genName(&gender);
 	_gender = (SoldierGender)gender;
-	_look = (SoldierLook)RNG::generate(0, 3);
+	_look = (SoldierLook)RNG::generate(RNG::STREAM_GEOSCAPE, 0, 3);
 
 	(*id)++; // increase id for next soldier
 }
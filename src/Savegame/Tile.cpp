@@ -17,6 +17,7 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "Tile.h"
+#include <algorithm>
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/MapDataSet.h"
 #include "../Engine/SurfaceSet.h"
@@ -103,6 +104,46 @@ void Tile::save(YAML::Emitter &out) const
 	out << YAML::EndMap;
 }
 
+/**
+ * Load the tile from a binary buffer, laid out as written
+ * by saveBinary. The mapdata pointers are set up later
+ * when the map resources are loaded.
+ * @param buffer Pointer to BINARY_SIZE bytes.
+ */
+void Tile::loadBinary(const Uint8 *buffer)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		_mapDataID[i] = (Sint16)(buffer[i * 2] | (buffer[i * 2 + 1] << 8));
+		_mapDataSetID[i] = (Sint8)buffer[8 + i];
+	}
+	_smoke = buffer[12];
+	_fire = buffer[13];
+	for (int i = 0; i < 3; ++i)
+	{
+		_discovered[i] = (buffer[14] & (1 << i)) != 0;
+	}
+}
+
+/**
+ * Saves the tile to a binary buffer: the four mapdata IDs as
+ * little-endian 16-bit numbers, the four mapdataset IDs as bytes,
+ * then the smoke, the fire and the discovered flags as bits.
+ * @param buffer Pointer to BINARY_SIZE bytes.
+ */
+void Tile::saveBinary(Uint8 *buffer) const
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		buffer[i * 2] = (Uint8)(_mapDataID[i] & 0xFF);
+		buffer[i * 2 + 1] = (Uint8)((_mapDataID[i] >> 8) & 0xFF);
+		buffer[8 + i] = (Uint8)(Sint8)_mapDataSetID[i];
+	}
+	buffer[12] = (Uint8)std::min(_smoke, 255);
+	buffer[13] = (Uint8)std::min(_fire, 255);
+	buffer[14] = (_discovered[0] ? 1 : 0) | (_discovered[1] ? 2 : 0) | (_discovered[2] ? 4 : 0);
+}
+
 /**
  * Get the MapData pointer of a part of the tile.
  * @param part the part 0-3.
@@ -394,11 +435,20 @@ void Tile::destroy(int part)
 	}
 }
 
-/* damage terrain  - check against armor*/
-void Tile::damage(int part, int power)
+/**
+ * Damages terrain - check against armor.
+ * @param part Part of the tile.
+ * @param power Power of the damage.
+ * @return True if the part was destroyed.
+ */
+bool Tile::damage(int part, int power)
 {
 	if (power >= _objects[part]->getArmor())
+	{
 		destroy(part);
+		return true;
+	}
+	return false;
 }
 
 
@@ -458,7 +508,7 @@ void Tile::detonate()
 		int flam = getFlammability();
 		if (flam <= 20)
 		{
-			if (RNG::generate(0, 20) - flam >= 0)
+			if (RNG::generate(RNG::STREAM_COMBAT, 0, 20) - flam >= 0)
 			{
 				ignite();
 			}
@@ -24,6 +24,7 @@
 #include "../Battlescape/Position.h"
 #include "../Ruleset/MapData.h"
 #include "BattleUnit.h"
+#include "SDL.h"
 
 
 namespace OpenXcom
@@ -65,6 +66,12 @@ public:
 	void load(const YAML::Node &node);
 	/// Saves the tile to yaml
 	void save(YAML::Emitter &out) const;
+	/// Size of a tile in the binary save format.
+	static const int BINARY_SIZE = 15;
+	/// Load the tile from a binary buffer
+	void loadBinary(const Uint8 *buffer);
+	/// Saves the tile to a binary buffer
+	void saveBinary(Uint8 *buffer) const;
 	/// Gets a pointer to the mapdata for a specific part of the tile.
 	MapData *getMapData(int part) const;
 	/// Sets the pointer to the mapdata for a specific part of the tile
@@ -104,7 +111,7 @@ public:
 	/// Destroy a tile part.
 	void destroy(int part);
 	/// Damage a tile part.
-	void damage(int part, int power);
+	bool damage(int part, int power);
 	/// Set a "virtual" explosive on this tile, to detonate later.
 	void setExplosive(int power);
 	/// Get explosive power of this tile.
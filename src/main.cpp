@@ -21,6 +21,8 @@
 #include "Engine/Game.h"
 #include "Engine/Screen.h"
 #include "Engine/Options.h"
+#include "Engine/AssetCache.h"
+#include "Engine/Profiler.h"
 #include "Menu/StartState.h"
 
 /** @mainpage
@@ -49,6 +51,7 @@ int main(int argc, char** args)
 	{
 #endif
 		Options::init(argc, args);
+		Profiler::init();
 		game = new Game("OpenXcom " + Options::getVersion(), 320, 200, 8);
 		game->getScreen()->setFullscreen(Options::getBool("fullscreen"));
 		game->getScreen()->setResolution(Options::getInt("displayWidth"), Options::getInt("displayHeight"));
@@ -64,8 +67,11 @@ int main(int argc, char** args)
 	}
 #endif
 	Options::save();
+	AssetCache::save();
+	Profiler::save();
 
 	// Comment this for faster exit.
 	delete game;
+	AssetCache::close();
 	return EXIT_SUCCESS;
 }
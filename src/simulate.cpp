@@ -0,0 +1,140 @@
+/*
+ * Copyright 2010 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <exception>
+#include "SDL.h"
+#include "Engine/Options.h"
+#include "Engine/RNG.h"
+#include "Engine/AssetCache.h"
+#include "Resource/XcomResourcePack.h"
+#include "Ruleset/XcomRuleset.h"
+#include "Savegame/SavedGame.h"
+#include "Savegame/SavedBattleGame.h"
+#include "Battlescape/BattleSimulator.h"
+
+/**
+ * Headless battlescape simulator.
+ * Loads a saved game that is in the middle of a battle and lets
+ * the AI play both sides with no video or sound, for benchmarking
+ * the battlescape engine and soak testing it for long periods.
+ *
+ * Usage: openxcom-simulate [-turns N] [-battles N] [-seed N] [-data PATH] [-user PATH] SAVE
+ *
+ * SAVE is the name of a save in the user folder, without the extension.
+ * Each battle is reloaded from the save once it's over or has run for
+ * the given number of turns.
+ */
+
+using namespace OpenXcom;
+
+int main(int argc, char** args)
+{
+	int turns = 100, battles = 1, seed = -1;
+	std::string save;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = args[i];
+		if (arg[0] == '-' && i + 1 < argc)
+		{
+			if (arg == "-turns")
+				turns = atoi(args[i + 1]);
+			else if (arg == "-battles")
+				battles = atoi(args[i + 1]);
+			else if (arg == "-seed")
+				seed = atoi(args[i + 1]);
+			++i;
+		}
+		else
+		{
+			save = arg;
+		}
+	}
+	if (save.empty())
+	{
+		std::cerr << "Usage: " << args[0] << " [-turns N] [-battles N] [-seed N] [-data PATH] [-user PATH] SAVE" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		Options::init(argc, args);
+		Options::setBool("mute", true);
+		if (SDL_Init(0) < 0)
+		{
+			std::cerr << SDL_GetError() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (Options::getBool("assetCache"))
+		{
+			AssetCache::open(Options::getUserFolder() + "assets.cache");
+		}
+		ResourcePack *res = new XcomResourcePack();
+		Ruleset *rules = new XcomRuleset();
+		Uint32 start = SDL_GetTicks();
+		int totalTurns = 0;
+
+		for (int i = 0; i < battles; ++i)
+		{
+			SavedGame *game = new SavedGame(DIFF_BEGINNER);
+			game->load(save, rules);
+			if (seed != -1)
+			{
+				RNG::init(seed + i);
+			}
+			SavedBattleGame *battle = game->getBattleGame();
+			if (battle == 0)
+			{
+				std::cerr << "ERROR: " << save << " is not in the middle of a battle" << std::endl;
+				return EXIT_FAILURE;
+			}
+			battle->loadMapResources(res);
+
+			BattleSimulator sim(battle, res, rules);
+			Uint32 battleStart = SDL_GetTicks();
+			while (sim.getTurns() < turns && !sim.isOver())
+			{
+				sim.playTurn();
+			}
+			totalTurns += sim.getTurns();
+
+			std::cout << "Battle " << i + 1 << (sim.isOver() ? " (finished)" : "") << std::endl;
+			sim.report(std::cout, (SDL_GetTicks() - battleStart) / 1000.0);
+			delete game;
+		}
+
+		double seconds = (SDL_GetTicks() - start) / 1000.0;
+		std::cout << "Total: " << totalTurns << " turns in " << seconds << "s" << std::endl;
+		std::cout << "Peak memory: " << BattleSimulator::getPeakMemory() << " KB" << std::endl;
+
+		AssetCache::save();
+		delete rules;
+		delete res;
+		AssetCache::close();
+		SDL_Quit();
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}